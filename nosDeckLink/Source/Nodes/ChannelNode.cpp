@@ -6,6 +6,11 @@
 #include "Generated/Conversion_generated.h"
 #include "Generated/DeckLink_generated.h"
 
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
 namespace nos::decklink
 {
 
@@ -19,6 +24,8 @@ NOS_REGISTER_NAME(IsOpen);
 NOS_REGISTER_NAME(ChannelId);
 NOS_REGISTER_NAME(ChannelResolution);
 NOS_REGISTER_NAME(ChannelPixelFormat);
+NOS_REGISTER_NAME(ChannelColorSpace);
+NOS_REGISTER_NAME(ChannelNarrowRange);
 
 enum class ChangedPinType
 {
@@ -37,21 +44,25 @@ enum class ChannelUpdateResult
 	Opened,
 };
 
-void InputVideoFormatChanged(void* userData, nosMediaIOFrameGeometry frameGeometry, nosMediaIOFrameRate frameRate, nosMediaIOPixelFormat pixelFormat);
+void InputVideoFormatChanged(void* userData, const nosDeckLinkInputVideoFormat* format);
 void FrameResultCallback(void* userData, nosDeckLinkFrameResult result, uint32_t processedFrameNumber);
 void DeviceInvalidated(void* userData);
-	
+void NOSAPI_CALL ChannelOpened(void* userData, nosDeckLinkChannel channel, nosDeckLinkChannelOperationStatus status, nosResult result);
+
 struct ChannelHandler
 {
 	NodeContext* Node;
 	bool ShouldOpen = true;
 	bool IsOpen = false;
+	bool OpenRequested = false; // An open is queued or done, and no close is requested since
 	bool IsStreamStarted = false;
 	nosUUID IsOpenPinId;
 	nosUUID ChannelNamePinId;
 	nosUUID OutChannelPinId;
 	nosUUID OutResolutionPinId;
 	nosUUID OutPixelFormatPinId;
+	nosUUID OutColorSpacePinId;
+	nosUUID OutNarrowRangePinId;
 	nosUUID ResolutionPinId;
 	nosUUID FrameRatePinId;
 	nosUUID PixelFormatPinId; 
@@ -61,6 +72,8 @@ struct ChannelHandler
 	nosMediaIOFrameGeometry Resolution = NOS_MEDIAIO_FRAME_GEOMETRY_INVALID;
 	nosMediaIOFrameRate FrameRate = NOS_MEDIAIO_FRAME_RATE_INVALID;
 	nosMediaIOPixelFormat PixelFormat = NOS_MEDIAIO_PIXEL_FORMAT_INVALID;
+	nosDeckLinkColorspace Colorspace = NOS_DECKLINK_COLORSPACE_UNKNOWN;
+	nosDeckLinkVideoRange Range = NOS_DECKLINK_VIDEO_RANGE_NARROW;
 	int32_t VideoInputChangeCallbackId = -1;
 	int32_t FrameResultCallbackId = -1;
 	int32_t DeviceInvalidatedCallbackId = -1;
@@ -69,15 +82,32 @@ struct ChannelHandler
 	{
 		uint32_t DropCount = 0;
 		uint32_t FramesSinceLastDrop = 0;
+		uint32_t LastProcessedFrameNumber = 0;
 		bool DropDetected = false;
-	} DeckLinkThread;
+	} CallbackThread;
+
+	// Channels are opened on the channel operation worker of the device. It only records the result, which is applied on the node thread.
+	// Shared with the pending operations, so the handler does not wait for them when it is destroyed.
+	struct OpenResults
+	{
+		std::mutex Mutex;
+		uint32_t Generation = 0; // Bumped by Close, results of opens queued before it are dropped
+		std::optional<nosResult> Result;
+	};
+	std::shared_ptr<OpenResults> PendingOpen = std::make_shared<OpenResults>();
+
+	struct OpenOperation
+	{
+		std::shared_ptr<OpenResults> Results;
+		uint32_t Generation;
+	};
 
 	template<auto Member, typename T>
 	ChannelUpdateResult Update(const T& value, bool reopen = true)
 	{
 		if (this->*Member == value)
 			return ChannelUpdateResult::NothingChanged;
-		if (reopen && IsOpen)
+		if (reopen && (IsOpen || OpenRequested))
 			Close();
 		this->*Member = value;
 		UpdateChannelStatusAndOutPins();
@@ -86,6 +116,24 @@ struct ChannelHandler
 		return ChannelUpdateResult::Opened;
 	}
 
+	/// Format changes of an open output are applied in place, falls back to reopening the channel.
+	template<auto Member, typename T>
+	ChannelUpdateResult UpdateFormat(const T& value)
+	{
+		if (!IsOpen || Direction != NOS_MEDIAIO_DIRECTION_OUTPUT || this->*Member == value)
+			return Update<Member>(value, Direction != NOS_MEDIAIO_DIRECTION_INPUT);
+		auto previous = this->*Member;
+		this->*Member = value;
+		if (CanOpen() && nosDeckLink->ReconfigureChannel(DeviceIndex, Channel, Resolution, FrameRate, PixelFormat) == NOS_RESULT_SUCCESS)
+		{
+			UpdateChannelStatusAndOutPins();
+			nosEngine.SendPathRestart(OutChannelPinId);
+			return ChannelUpdateResult::Opened;
+		}
+		this->*Member = previous;
+		return Update<Member>(value);
+	}
+
 	ChannelHandler(NodeContext* node) : Node(node)
 	{
 		UpdateChannelStatus();
@@ -96,38 +144,47 @@ struct ChannelHandler
 		Close();
 	}
 
-	void OnInputVideoFormatChanged_DeckLinkThread(nosMediaIOFrameGeometry frameGeometry, nosMediaIOFrameRate frameRate, nosMediaIOPixelFormat pixelFormat)
-	{
-		const char* frameGeometryCstr = nosMediaIO->GetFrameGeometryName(frameGeometry);
-		const char* frameRateCstr = nosMediaIO->GetFrameRateName(frameRate);
-		const char* pixelFormatCstr = nosMediaIO->GetPixelFormatName(pixelFormat);
-		Resolution = frameGeometry;
-		FrameRate = frameRate;
-		PixelFormat = pixelFormat;
-		nosEngine.SetPinValue(ResolutionPinId, nos::Buffer(frameGeometryCstr, strlen(frameGeometryCstr) + 1));
-		nosEngine.SetPinValue(FrameRatePinId, nos::Buffer(frameRateCstr, strlen(frameRateCstr) + 1));
-		nosEngine.SetPinValue(PixelFormatPinId, nos::Buffer(pixelFormatCstr, strlen(pixelFormatCstr) + 1));
-		UpdateChannelStatus();
+	void OnInputVideoFormatChanged_CallbackThread(nosDeckLinkInputVideoFormat const& format)
+	{
+		if (format.Geometry != Resolution || format.FrameRate != FrameRate || format.PixelFormat != PixelFormat)
+		{
+			const char* frameGeometryCstr = nosMediaIO->GetFrameGeometryName(format.Geometry);
+			const char* frameRateCstr = nosMediaIO->GetFrameRateName(format.FrameRate);
+			const char* pixelFormatCstr = nosMediaIO->GetPixelFormatName(format.PixelFormat);
+			Resolution = format.Geometry;
+			FrameRate = format.FrameRate;
+			PixelFormat = format.PixelFormat;
+			nosEngine.SetPinValue(ResolutionPinId, nos::Buffer(frameGeometryCstr, strlen(frameGeometryCstr) + 1));
+			nosEngine.SetPinValue(FrameRatePinId, nos::Buffer(frameRateCstr, strlen(frameRateCstr) + 1));
+			nosEngine.SetPinValue(PixelFormatPinId, nos::Buffer(pixelFormatCstr, strlen(pixelFormatCstr) + 1));
+			UpdateChannelStatus();
+		}
+		Colorspace = format.Colorspace;
+		Range = format.Range;
+		UpdateColorimetryOutPins();
 	}
 
-	void OnFrameEnd_DeckLinkThread(nosDeckLinkFrameResult result, uint32_t processedFrameNumber)
+	void OnFrameEnd_CallbackThread(nosDeckLinkFrameResult result, uint32_t processedFrameNumber)
 	{
+		// Consecutive drops can be reported with a single call, count them by the frame number gap.
+		uint32_t framesSinceLastCall = processedFrameNumber > CallbackThread.LastProcessedFrameNumber ? processedFrameNumber - CallbackThread.LastProcessedFrameNumber : 1;
+		CallbackThread.LastProcessedFrameNumber = processedFrameNumber;
 		switch (result)
 		{
 		case NOS_DECKLINK_FRAME_DROPPED:
 		{
-			++DeckLinkThread.DropCount;
-			DeckLinkThread.FramesSinceLastDrop = 0;
-			DeckLinkThread.DropDetected = true;
-			SetStatus(StatusType::DropCount, fb::NodeStatusMessageType::WARNING, "Drop Count: " + std::to_string(DeckLinkThread.DropCount));
+			CallbackThread.DropCount += framesSinceLastCall;
+			CallbackThread.FramesSinceLastDrop = 0;
+			CallbackThread.DropDetected = true;
+			SetStatus(StatusType::DropCount, fb::NodeStatusMessageType::WARNING, "Drop Count: " + std::to_string(CallbackThread.DropCount));
 			UpdateStatus();
 			break;
 		}
 		case NOS_DECKLINK_FRAME_COMPLETED:
 		{
-			if (DeckLinkThread.DropDetected)
-				++DeckLinkThread.FramesSinceLastDrop;
-			if (DeckLinkThread.FramesSinceLastDrop > 50)
+			if (CallbackThread.DropDetected)
+				++CallbackThread.FramesSinceLastDrop;
+			if (CallbackThread.FramesSinceLastDrop > 50)
 			{
 				nosEngine.LogW("Requesting path restart due to frame drops");
 				nosEngine.SendPathRestart(OutChannelPinId);
@@ -151,9 +208,10 @@ struct ChannelHandler
 		return true;
 	}
 	
+	/// Returns whether the open is queued, its result is applied by ApplyOpenResult.
 	bool Open()
 	{
-		if (IsOpen)
+		if (IsOpen || OpenRequested)
 			return true;
 		if (!CanOpen())
 			return false;
@@ -170,11 +228,36 @@ struct ChannelHandler
 		}
 		else
 		{
-			VideoInputChangeCallbackId = nosDeckLink->RegisterInputVideoFormatChangeCallback(DeviceIndex, Channel, &InputVideoFormatChanged, this);
+			Colorspace = NOS_DECKLINK_COLORSPACE_UNKNOWN;
+			Range = NOS_DECKLINK_VIDEO_RANGE_NARROW;
+			VideoInputChangeCallbackId = nosDeckLink->RegisterInputVideoFormatChangeCallbackV2(DeviceIndex, Channel, &InputVideoFormatChanged, this);
 		}
 		DeviceInvalidatedCallbackId = nosDeckLink->RegisterDeviceInvalidatedCallback(DeviceIndex, &decklink::DeviceInvalidated, this);
-		auto res = nosDeckLink->OpenChannel(DeviceIndex, &params);
+		uint32_t generation;
+		{
+			std::unique_lock lock(PendingOpen->Mutex);
+			generation = PendingOpen->Generation;
+		}
+		auto* operation = new OpenOperation{PendingOpen, generation};
+		auto res = nosDeckLink->OpenChannelAsync(DeviceIndex, &params, &ChannelOpened, operation);
 		if (res == NOS_RESULT_SUCCESS)
+			OpenRequested = true;
+		else
+			delete operation;
+		UpdateChannelStatusAndOutPins();
+		return res == NOS_RESULT_SUCCESS;
+	}
+
+	void ApplyOpenResult()
+	{
+		std::optional<nosResult> result;
+		{
+			std::unique_lock lock(PendingOpen->Mutex);
+			result = std::exchange(PendingOpen->Result, std::nullopt);
+		}
+		if (!result)
+			return;
+		if (*result == NOS_RESULT_SUCCESS)
 		{
 			IsOpen = true;
 			Node->SetPinOrphanState(OutChannelPinId, fb::PinOrphanStateType::ACTIVE, nullptr);
@@ -182,12 +265,13 @@ struct ChannelHandler
 			nosEngine.SetPinValue(OutChannelPinId, nos::Buffer::From(id));
 			nosEngine.SendPathRestart(OutChannelPinId);
 			FrameResultCallbackId = nosDeckLink->RegisterFrameResultCallback(DeviceIndex, Channel, &FrameResultCallback, this);
-			DeckLinkThread = {};
+			CallbackThread = {};
 			ClearStatus(StatusType::DropCount);
 			UpdateStatus();
 		}
+		else
+			OpenRequested = false;
 		UpdateChannelStatusAndOutPins();
-		return res == NOS_RESULT_SUCCESS;
 	}
 
 	void StartIfOpen()
@@ -201,18 +285,27 @@ struct ChannelHandler
 		if (IsOpen)
 		{
 			nosDeckLink->StopStream(DeviceIndex, Channel);
-			DeckLinkThread.DropDetected = false;
-			DeckLinkThread.FramesSinceLastDrop = 0;
+			CallbackThread.DropDetected = false;
+			CallbackThread.FramesSinceLastDrop = 0;
+			CallbackThread.LastProcessedFrameNumber = 0;
 		}
 	}
 
 	void Close()
 	{
+		{
+			std::unique_lock lock(PendingOpen->Mutex);
+			++PendingOpen->Generation;
+			PendingOpen->Result = std::nullopt;
+		}
 		if (Direction == NOS_MEDIAIO_DIRECTION_INPUT)
-			nosDeckLink->UnregisterInputVideoFormatChangeCallback(DeviceIndex, Channel, VideoInputChangeCallbackId);
+			nosDeckLink->UnregisterInputVideoFormatChangeCallbackV2(DeviceIndex, Channel, VideoInputChangeCallbackId);
 		nosDeckLink->UnregisterFrameResultCallback(DeviceIndex, Channel, FrameResultCallbackId);
-		nosDeckLink->CloseChannel(DeviceIndex, Channel);
+		FrameResultCallbackId = -1;
+		// Queued after a pending open of the same device, so it closes what that open opens.
+		nosDeckLink->CloseChannelAsync(DeviceIndex, Channel, nullptr, nullptr);
 		IsOpen = false;
+		OpenRequested = false;
 		nosEngine.SetPinValue(OutChannelPinId, nos::Buffer::From(ChannelId(-1, 0, false)));
 		nosEngine.SetPinValue(OutResolutionPinId, nos::Buffer::From(nosVec2u{ 0, 0 }));
 		nosEngine.SendPathRestart(OutChannelPinId);
@@ -243,11 +336,15 @@ struct ChannelHandler
 		}
 		else
 		{
-			if (ShouldOpen && !IsOpen && CanOpen())
+			if (ShouldOpen && OpenRequested)
+			{
+				type = fb::NodeStatusMessageType::INFO;
+				statusText = "Opening: " + channelString;
+			}
+			else if (ShouldOpen && !IsOpen && CanOpen())
 			{
 				type = fb::NodeStatusMessageType::FAILURE;
 				statusText = "Failed to open: " + channelString;
-				
 			}
 			else if (!ShouldOpen)
 			{
@@ -281,6 +378,32 @@ struct ChannelHandler
 			break;
 		}
 		nosEngine.SetPinValue(OutPixelFormatPinId, nos::Buffer::From(ycbcrFormat));
+		UpdateColorimetryOutPins();
+	}
+
+	void UpdateColorimetryOutPins()
+	{
+		// Sources that don't signal their colorspace are assumed to follow their resolution, as BT.601 for SD and BT.709 otherwise.
+		nos::mediaio::ColorSpace colorSpace = nos::mediaio::ColorSpace::REC709;
+		switch (Colorspace)
+		{
+		case NOS_DECKLINK_COLORSPACE_REC601:
+			colorSpace = nos::mediaio::ColorSpace::REC601;
+			break;
+		case NOS_DECKLINK_COLORSPACE_REC2020:
+			colorSpace = nos::mediaio::ColorSpace::REC2020;
+			break;
+		case NOS_DECKLINK_COLORSPACE_UNKNOWN:
+		{
+			nosVec2u resolution{};
+			nosMediaIO->Get2DFrameResolution(Resolution, &resolution);
+			if (resolution.y != 0 && resolution.y <= 576)
+				colorSpace = nos::mediaio::ColorSpace::REC601;
+			break;
+		}
+		}
+		nosEngine.SetPinValue(OutColorSpacePinId, nos::Buffer::From(colorSpace));
+		nosEngine.SetPinValue(OutNarrowRangePinId, nos::Buffer::From(Range == NOS_DECKLINK_VIDEO_RANGE_NARROW));
 	}
 
 	void UpdateChannelStatusAndOutPins()
@@ -306,14 +429,14 @@ struct ChannelHandler
 	std::map<StatusType, fb::TNodeStatusMessage> StatusMessages;
 };
 
-void InputVideoFormatChanged(void* userData, nosMediaIOFrameGeometry frameGeometry, nosMediaIOFrameRate frameRate, nosMediaIOPixelFormat pixelFormat)
+void InputVideoFormatChanged(void* userData, const nosDeckLinkInputVideoFormat* format)
 {
-	static_cast<ChannelHandler*>(userData)->OnInputVideoFormatChanged_DeckLinkThread(frameGeometry, frameRate, pixelFormat);
+	static_cast<ChannelHandler*>(userData)->OnInputVideoFormatChanged_CallbackThread(*format);
 }
 
 void FrameResultCallback(void* userData, nosDeckLinkFrameResult result, uint32_t processedFrameNumber)
 {
-	static_cast<ChannelHandler*>(userData)->OnFrameEnd_DeckLinkThread(result, processedFrameNumber);
+	static_cast<ChannelHandler*>(userData)->OnFrameEnd_CallbackThread(result, processedFrameNumber);
 }
 
 void DeviceInvalidated(void* userData)
@@ -321,6 +444,19 @@ void DeviceInvalidated(void* userData)
 	static_cast<ChannelHandler*>(userData)->DeviceInvalidated();
 }
 
+void NOSAPI_CALL ChannelOpened(void* userData, nosDeckLinkChannel channel, nosDeckLinkChannelOperationStatus status, nosResult result)
+{
+	if (status != NOS_DECKLINK_CHANNEL_OPERATION_FINISHED)
+		return;
+	auto* operation = static_cast<ChannelHandler::OpenOperation*>(userData);
+	{
+		std::unique_lock lock(operation->Results->Mutex);
+		if (operation->Generation == operation->Results->Generation)
+			operation->Results->Result = result;
+	}
+	delete operation;
+}
+
 class ChannelNode : public nos::NodeContext
 {
 public:
@@ -337,6 +473,8 @@ public:
 		Channel.OutChannelPinId = *GetPinId(NSN_ChannelId);
 		Channel.OutResolutionPinId = *GetPinId(NSN_ChannelResolution);
 		Channel.OutPixelFormatPinId = *GetPinId(NSN_ChannelPixelFormat);
+		Channel.OutColorSpacePinId = *GetPinId(NSN_ChannelColorSpace);
+		Channel.OutNarrowRangePinId = *GetPinId(NSN_ChannelNarrowRange);
 		Channel.ResolutionPinId = *GetPinId(NSN_Resolution);
 		Channel.FrameRatePinId = *GetPinId(NSN_FrameRate);
 		Channel.PixelFormatPinId = *GetPinId(NSN_PixelFormat);
@@ -391,7 +529,7 @@ public:
 		AddPinValueWatcher(NSN_Resolution, [this](const nos::Buffer& newVal, std::optional<nos::Buffer> oldValue) {
 			ResolutionPinValue = InterpretPinValue<const char>(newVal);
 			auto newResolution = nosMediaIO->GetFrameGeometryFromString(ResolutionPinValue.c_str());
-			Channel.Update<&ChannelHandler::Resolution>(newResolution, Channel.Direction != NOS_MEDIAIO_DIRECTION_INPUT);
+			Channel.UpdateFormat<&ChannelHandler::Resolution>(newResolution);
 			if (ResolutionPinValue != "NONE" && newResolution == NOS_MEDIAIO_FRAME_GEOMETRY_INVALID)
 				ResetPin(NSN_Resolution);
 			else
@@ -406,7 +544,7 @@ public:
 		AddPinValueWatcher(NSN_FrameRate, [this](const nos::Buffer& newVal, std::optional<nos::Buffer> oldValue) {
 			FrameRatePinValue = InterpretPinValue<const char>(newVal);
 			auto newFrameRate = nosMediaIO->GetFrameRateFromString(FrameRatePinValue.c_str());
-			Channel.Update<&ChannelHandler::FrameRate>(newFrameRate, Channel.Direction != NOS_MEDIAIO_DIRECTION_INPUT);
+			Channel.UpdateFormat<&ChannelHandler::FrameRate>(newFrameRate);
 			if (FrameRatePinValue != "NONE" && newFrameRate == NOS_MEDIAIO_FRAME_RATE_INVALID)
 				ResetPin(NSN_FrameRate);
 			else
@@ -421,7 +559,7 @@ public:
 		AddPinValueWatcher(NSN_PixelFormat, [this](const nos::Buffer& newVal, std::optional<nos::Buffer> oldValue) {
 			PixelFormatPinValue = InterpretPinValue<const char>(newVal);
 			auto newPixelFormat = nosMediaIO->GetPixelFormatFromString(PixelFormatPinValue.c_str());
-			Channel.Update<&ChannelHandler::PixelFormat>(newPixelFormat, Channel.Direction != NOS_MEDIAIO_DIRECTION_INPUT);
+			Channel.UpdateFormat<&ChannelHandler::PixelFormat>(newPixelFormat);
 			if (PixelFormatPinValue != "NONE" && newPixelFormat == NOS_MEDIAIO_PIXEL_FORMAT_INVALID)
 				ResetPin(NSN_FrameRate);
 			else
@@ -518,6 +656,7 @@ public:
 
 	nosResult ExecuteNode(nosNodeExecuteParams* params) override
 	{
+		Channel.ApplyOpenResult();
 		Channel.StartIfOpen();
 		return Channel.IsOpen ? NOS_RESULT_SUCCESS : NOS_RESULT_FAILED;
 	}
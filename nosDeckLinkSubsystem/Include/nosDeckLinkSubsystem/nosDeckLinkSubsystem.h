@@ -20,10 +20,20 @@ typedef struct nosDeckLinkDeviceDesc {
 	char UniqueDisplayName[256];
 } nosDeckLinkDeviceDesc;
 
+typedef struct nosDeckLinkDevicePlacement
+{
+	int32_t NumaNode; // NUMA node the card is attached to, -1 if unknown
+	char PciAddress[32]; // domain:bus:device.function, empty if unknown
+	bool FrameMemoryOnNumaNode; // Frame buffers are allocated on NumaNode
+	bool CallbackThreadPinned; // Callbacks run on cores of NumaNode
+	bool PinDmaThreads; // DMATransfer runs on cores of NumaNode while it copies, see nosDeckLinkFrameInfo::DmaThreadPinned
+} nosDeckLinkDevicePlacement;
+
 typedef struct nosDeckLinkDeviceInfo
 {
 	nosDeckLinkDeviceDesc Desc;
 	char ModelName[256];
+	nosDeckLinkDevicePlacement Placement;
 } nosDeckLinkDeviceInfo;
 	
 typedef enum nosDeckLinkChannel
@@ -38,10 +48,21 @@ typedef enum nosDeckLinkChannel
 	NOS_DECKLINK_CHANNEL_SINGLE_LINK_6,
 	NOS_DECKLINK_CHANNEL_SINGLE_LINK_7,
 	NOS_DECKLINK_CHANNEL_SINGLE_LINK_8,
-	NOS_DECKLINK_CHANNEL_MAX = NOS_DECKLINK_CHANNEL_SINGLE_LINK_8
+	// Multi-link channels send one picture over consecutive SDI ports, named after the first and last port.
+	NOS_DECKLINK_CHANNEL_DUAL_LINK_1,
+	NOS_DECKLINK_CHANNEL_DUAL_LINK_2,
+	NOS_DECKLINK_CHANNEL_DUAL_LINK_3,
+	NOS_DECKLINK_CHANNEL_DUAL_LINK_4,
+	// Two-sample interleave (2SI): every link carries a quarter resolution picture of the whole frame.
+	NOS_DECKLINK_CHANNEL_QUAD_LINK_1,
+	NOS_DECKLINK_CHANNEL_QUAD_LINK_2,
+	// Square division: every link carries one quadrant of the frame.
+	NOS_DECKLINK_CHANNEL_QUAD_LINK_SQUARE_DIVISION_1,
+	NOS_DECKLINK_CHANNEL_QUAD_LINK_SQUARE_DIVISION_2,
+	NOS_DECKLINK_CHANNEL_MAX = NOS_DECKLINK_CHANNEL_QUAD_LINK_SQUARE_DIVISION_2
 } nosDeckLinkChannel;
 
-#define NOS_DECKLINK_CHANNEL_COUNT (NOS_DECKLINK_CHANNEL_SINGLE_LINK_8 - NOS_DECKLINK_CHANNEL_INVALID)
+#define NOS_DECKLINK_CHANNEL_COUNT (NOS_DECKLINK_CHANNEL_MAX - NOS_DECKLINK_CHANNEL_INVALID)
 
 inline const char* NOS_DECKLINK_CHANNEL_NAMES[] = {
 	"INVALID",
@@ -53,6 +74,14 @@ inline const char* NOS_DECKLINK_CHANNEL_NAMES[] = {
 	"Single Link 6",
 	"Single Link 7",
 	"Single Link 8",
+	"Dual Link 1-2",
+	"Dual Link 3-4",
+	"Dual Link 5-6",
+	"Dual Link 7-8",
+	"Quad Link 1-4",
+	"Quad Link 5-8",
+	"Quad Link SQD 1-4",
+	"Quad Link SQD 5-8",
 };
 
 typedef struct nosDeckLinkChannelList {
@@ -60,6 +89,56 @@ typedef struct nosDeckLinkChannelList {
 	nosDeckLinkChannel Channels[NOS_DECKLINK_CHANNEL_COUNT];
 } nosDeckLinkAvailableChannels;
 
+typedef enum nosDeckLinkAudioSampleType
+{
+	NOS_DECKLINK_AUDIO_SAMPLE_TYPE_INT32,
+	NOS_DECKLINK_AUDIO_SAMPLE_TYPE_INT16,
+} nosDeckLinkAudioSampleType;
+
+typedef enum nosDeckLinkTimecodeFormat
+{
+	NOS_DECKLINK_TIMECODE_FORMAT_RP188_LTC,
+	NOS_DECKLINK_TIMECODE_FORMAT_RP188_VITC1,
+	NOS_DECKLINK_TIMECODE_FORMAT_RP188_VITC2,
+	NOS_DECKLINK_TIMECODE_FORMAT_RP188_HIGH_FRAME_RATE,
+	NOS_DECKLINK_TIMECODE_FORMAT_VITC,
+	NOS_DECKLINK_TIMECODE_FORMAT_VITC_FIELD2,
+	NOS_DECKLINK_TIMECODE_FORMAT_COUNT
+} nosDeckLinkTimecodeFormat;
+
+typedef struct nosDeckLinkTimecode
+{
+	bool Valid; // False if the frame doesn't carry this timecode
+	uint8_t Hours;
+	uint8_t Minutes;
+	uint8_t Seconds;
+	uint8_t Frames;
+	bool DropFrame;
+	bool FieldMark;
+	uint32_t UserBits;
+} nosDeckLinkTimecode;
+
+typedef enum nosDeckLinkOutputTimecodeMode
+{
+	NOS_DECKLINK_OUTPUT_TIMECODE_MODE_NONE,
+	NOS_DECKLINK_OUTPUT_TIMECODE_MODE_MANUAL, // Each frame gets the timecode set with SetOutputTimecode before its DMATransfer
+	NOS_DECKLINK_OUTPUT_TIMECODE_MODE_GENERATE, // Counts up from the timecode set with SetOutputTimecode, 00:00:00:00 by default
+} nosDeckLinkOutputTimecodeMode;
+
+typedef enum nosDeckLinkKeyerMode
+{
+	NOS_DECKLINK_KEYER_MODE_NONE,
+	NOS_DECKLINK_KEYER_MODE_INTERNAL, // Hardware keyer mixes the frames over the input of the same connector
+	NOS_DECKLINK_KEYER_MODE_EXTERNAL, // Hardware keyer sends fill and key on the connector pair of the channel
+	NOS_DECKLINK_KEYER_MODE_FILL_KEY_PAIR, // For cards without a keyer. Fill on the channel, key on the next channel, split in software.
+} nosDeckLinkKeyerMode;
+
+typedef enum nosDeckLinkKeyerSourceFormat
+{
+	NOS_DECKLINK_KEYER_SOURCE_FORMAT_BGRA,
+	NOS_DECKLINK_KEYER_SOURCE_FORMAT_RGBA, // Swizzled while copying into the frame
+} nosDeckLinkKeyerSourceFormat;
+
 typedef struct nosDeckLinkOpenChannelParams
 {
 	nosMediaIODirection Direction;
@@ -69,19 +148,204 @@ typedef struct nosDeckLinkOpenChannelParams
 	{
 		nosMediaIOFrameGeometry Geometry;
 		nosMediaIOFrameRate FrameRate;	
+		nosDeckLinkOutputTimecodeMode TimecodeMode;
+		nosDeckLinkTimecodeFormat TimecodeFormat; // RP188 formats are embedded as ATC, VITC formats on the VITC lines
+		// Keyed outputs ignore PixelFormat and take 8-bit frames with alpha, see KeyerSourceFormat.
+		nosDeckLinkKeyerMode KeyerMode;
+		nosDeckLinkKeyerSourceFormat KeyerSourceFormat;
 	} Output; // Don't care if Direction == NOS_MEDIAIO_DIRECTION_INPUT
+	struct
+	{
+		uint32_t ChannelCount; // 0 to disable audio. Otherwise 2, 8, 16, 32 or 64, up to what the card supports.
+		nosDeckLinkAudioSampleType SampleType;
+	} Audio; // Embedded audio, always 48 kHz and interleaved
+	bool CaptureAncillaryPackets; // Input only, see ReadAncillaryPackets
+	// Input only. Captures both eyes of a dual-stream 3D signal. DMATransfer then reads two frames into one packed buffer,
+	// left eye first, and the right eye is only written if the buffer has room for it. See nosDeckLinkFrameInfo::HasRightEye.
+	bool DualStream3D;
 } nosDeckLinkOpenOutputParams;
 
+typedef struct nosDeckLinkAudioPacketInfo
+{
+	int64_t PacketTime; // In the time scale of the video stream, see GetCurrentDeltaSecondsOfChannel
+	int64_t FrameTime; // Stream time of the video frame the packet arrived with, in the same time scale
+	uint32_t SampleFrameCount; // A sample frame has one sample for each audio channel
+	uint32_t ChannelCount;
+	nosDeckLinkAudioSampleType SampleType;
+} nosDeckLinkAudioPacketInfo;
+
+typedef struct nosDeckLinkAncillaryPacket
+{
+	const uint8_t* Data; // User data words, 8 bits each, without the ancillary data flag, DID, SDID, data count and checksum
+	uint32_t Size;
+	uint32_t Line;
+	uint8_t DID;
+	uint8_t SDID;
+	uint8_t DataStreamIndex;
+} nosDeckLinkAncillaryPacket;
+
+typedef struct nosDeckLinkAncillaryPacketList
+{
+	const nosDeckLinkAncillaryPacket* Packets;
+	uint32_t Count;
+	uint32_t DroppedCount; // Packets that did not fit into the per-frame arena
+	int64_t FrameTime; // Stream time of the video frame, in the time scale of the video stream
+} nosDeckLinkAncillaryPacketList;
+
+typedef struct nosDeckLinkFrameInfo
+{
+	int64_t FrameTime; // Stream time, in the time scale of the video stream
+	int64_t FrameDuration;
+	nosDeckLinkTimecode Timecodes[NOS_DECKLINK_TIMECODE_FORMAT_COUNT]; // Indexed by nosDeckLinkTimecodeFormat
+	bool HasRightEye; // Channels opened with DualStream3D, false if the frame arrived without a right eye
+	bool DmaThreadPinned; // The calling thread ran on cores of the NUMA node of the card during this transfer, affinity is restored afterwards
+} nosDeckLinkFrameInfo;
+
+typedef struct nosDeckLinkAudioOutputStatus
+{
+	uint32_t BufferedSampleFrameCount; // Sample frames buffered by the driver right now
+	uint32_t MinBufferedSampleFrameCount; // Low watermark since the stream started
+	uint32_t MaxBufferedSampleFrameCount; // High watermark since the stream started
+	uint64_t SilentSampleFramesInserted; // Padded with silence because fewer samples than a frame needs were written
+} nosDeckLinkAudioOutputStatus;
+
+typedef struct nosDeckLinkChannelFrameMemoryInfo
+{
+	size_t PageSize; // Smallest page size backing the frame buffers, 0 if frames are allocated by the DeckLink driver
+	int32_t NumaNode; // NUMA node all frame buffers are bound to, -1 if not bound
+} nosDeckLinkChannelFrameMemoryInfo;
+
+typedef enum nosDeckLinkMemoryPurpose
+{
+	NOS_DECKLINK_MEMORY_PURPOSE_OUTPUT_FRAMES, // Frames of an output, allocated by the driver or backed by own buffers
+	NOS_DECKLINK_MEMORY_PURPOSE_INPUT_FRAME_QUEUE, // Captured frames waiting for DMATransfer. Frames the driver is capturing into are not visible.
+	NOS_DECKLINK_MEMORY_PURPOSE_IDLE_FRAME_BUFFERS, // Own frame buffers kept by the channel for reuse. Idle buffers of the shared pool are in nosDeckLinkFramePoolUsage.
+	NOS_DECKLINK_MEMORY_PURPOSE_AUDIO, // Input: Capture ring. Output: Audio block of the next frame.
+	NOS_DECKLINK_MEMORY_PURPOSE_ANCILLARY, // Input: Ancillary packet arenas
+	NOS_DECKLINK_MEMORY_PURPOSE_COUNT
+} nosDeckLinkMemoryPurpose;
+
+typedef struct nosDeckLinkMemoryUsage
+{
+	uint64_t Bytes; // Held right now
+	uint64_t PeakBytes; // High watermark since the device is found, or since statistics of the channel are reset
+} nosDeckLinkMemoryUsage;
+
+typedef struct nosDeckLinkChannelMemoryUsage
+{
+	nosDeckLinkChannel Channel; // Channel the memory was last held for
+	nosMediaIODirection Direction;
+	nosDeckLinkMemoryUsage Total;
+	nosDeckLinkMemoryUsage Purposes[NOS_DECKLINK_MEMORY_PURPOSE_COUNT]; // Indexed by nosDeckLinkMemoryPurpose
+} nosDeckLinkChannelMemoryUsage;
+
+typedef struct nosDeckLinkDeviceMemoryUsage
+{
+	nosDeckLinkMemoryUsage Total; // Peak is of the device as a whole since it is found, not the sum of the peaks of its channels
+	size_t ChannelCount;
+	// Channels that hold or held memory, open or not. Memory still held by a closed channel is leaked.
+	nosDeckLinkChannelMemoryUsage Channels[2 * NOS_DECKLINK_CHANNEL_COUNT];
+} nosDeckLinkDeviceMemoryUsage;
+
+typedef struct nosDeckLinkFramePoolUsage
+{
+	uint64_t MemoryLimit; // Bytes, 0 if the pool has no limit
+	uint64_t ChannelQuota; // Bytes a single channel can lease, 0 if channels have no quota
+	uint64_t ResidentBytes; // Memory of all buffers of the pool, leased or idle
+	uint64_t LeasedBytes; // Memory of the buffers channels are using
+	uint64_t PeakResidentBytes; // High watermark of ResidentBytes
+	uint32_t BufferCount;
+	uint32_t LeasedBufferCount;
+	uint32_t SizeClassCount; // Buffers are bucketed by size, rounded up to 2 MiB, and by placement
+	uint64_t FailedLeaseCount; // Leases refused by the quota or the memory limit, or failed to allocate
+} nosDeckLinkFramePoolUsage;
+
+typedef struct nosDeckLinkChannelStatistics
+{
+	uint64_t FramesCompleted; // Input: Frames queued for reading. Output: Frames displayed, including the ones displayed late.
+	uint64_t FramesDropped; // Input: Frames arrived while the read queue was full. Output: Frames not displayed.
+	uint64_t FramesDisplayedLate; // Output only
+	uint64_t CallbackDeadlinesMissed; // Frame result callbacks that started more than a frame interval after the frame event
+	uint64_t MaxCallbackLatencyUs; // Longest time between a frame event and its frame result callback
+} nosDeckLinkChannelStatistics;
+
+typedef enum nosDeckLinkEOTF
+{
+	NOS_DECKLINK_EOTF_SDR,
+	NOS_DECKLINK_EOTF_HDR, // Traditional gamma HDR
+	NOS_DECKLINK_EOTF_PQ, // SMPTE ST 2084
+	NOS_DECKLINK_EOTF_HLG, // ITU-R BT.2100 Hybrid Log-Gamma
+} nosDeckLinkEOTF; // As in CTA-861.3
+
+typedef struct nosDeckLinkChromaticity
+{
+	double X;
+	double Y;
+} nosDeckLinkChromaticity;
+
+typedef struct nosDeckLinkHDRMetadata
+{
+	bool Present; // False if frames carry no HDR metadata
+	nosDeckLinkEOTF EOTF;
+	nosDeckLinkChromaticity RedPrimary;
+	nosDeckLinkChromaticity GreenPrimary;
+	nosDeckLinkChromaticity BluePrimary;
+	nosDeckLinkChromaticity WhitePoint;
+	double MaxDisplayMasteringLuminance; // cd/m2
+	double MinDisplayMasteringLuminance; // cd/m2
+	double MaxContentLightLevel; // MaxCLL, cd/m2
+	double MaxFrameAverageLightLevel; // MaxFALL, cd/m2
+} nosDeckLinkHDRMetadata;
+
+typedef enum nosDeckLinkColorspace
+{
+	NOS_DECKLINK_COLORSPACE_UNKNOWN, // Not signalled by the source or not reported by the device
+	NOS_DECKLINK_COLORSPACE_REC601,
+	NOS_DECKLINK_COLORSPACE_REC709,
+	NOS_DECKLINK_COLORSPACE_REC2020,
+} nosDeckLinkColorspace;
+
+typedef enum nosDeckLinkVideoRange
+{
+	NOS_DECKLINK_VIDEO_RANGE_NARROW, // SMPTE legal levels, e.g. 64-940 for 10-bit
+	NOS_DECKLINK_VIDEO_RANGE_FULL,
+} nosDeckLinkVideoRange;
+
+typedef struct nosDeckLinkInputVideoFormat
+{
+	nosMediaIOFrameGeometry Geometry;
+	nosMediaIOFrameRate FrameRate;
+	nosMediaIOPixelFormat PixelFormat;
+	nosDeckLinkHDRMetadata HDR;
+	nosDeckLinkColorspace Colorspace; // YCbCr matrix of the incoming signal
+	nosDeckLinkVideoRange Range; // Of the captured frame buffers, follows from the capture pixel format
+	bool DualStream3D; // Signal carries a right eye stream, captured only if the channel is opened with DualStream3D
+} nosDeckLinkInputVideoFormat;
+
 typedef enum nosDeckLinkFrameResult
 {
 	NOS_DECKLINK_FRAME_COMPLETED, // Frame arrived if it's an input channel, frame displayed if it's an output channel
 	NOS_DECKLINK_FRAME_DROPPED,
 } nosDeckLinkFrameResult;
 
+// Format change and frame result callbacks are called from a subsystem-owned thread, not from the DeckLink threads.
+// If drops pile up while a frame result callback is busy, consecutive drops are reported with a single call carrying the last processed frame number.
+// Once an Unregister*Callback function returns, the callback is not running and won't be called again, unless it is called from inside a callback.
 typedef void (NOSAPI_CALL* nosDeckLinkInputVideoFormatChangeCallback)(void* userData, nosMediaIOFrameGeometry geometry, nosMediaIOFrameRate frameRate, nosMediaIOPixelFormat pixelFormat);
+// Also called when only the HDR metadata or the colorspace of the incoming frames changes. format is valid during the call only.
+typedef void (NOSAPI_CALL* nosDeckLinkInputVideoFormatChangeCallbackV2)(void* userData, const nosDeckLinkInputVideoFormat* format);
 typedef void (NOSAPI_CALL* nosDeckLinkFrameResultCallback)(void* userData, nosDeckLinkFrameResult result, uint32_t processedFrameNumber);
 typedef void (NOSAPI_CALL* nosDeckLinkDeviceInvalidatedCallback)(void* userData);
 
+typedef enum nosDeckLinkChannelOperationStatus
+{
+	NOS_DECKLINK_CHANNEL_OPERATION_STARTED, // The worker picked the operation up, result is NOS_RESULT_SUCCESS
+	NOS_DECKLINK_CHANNEL_OPERATION_FINISHED, // result is what the blocking variant would have returned
+} nosDeckLinkChannelOperationStatus;
+
+// Called from the channel operation worker of the device, without any subsystem lock held.
+typedef void (NOSAPI_CALL* nosDeckLinkChannelOperationCallback)(void* userData, nosDeckLinkChannel channel, nosDeckLinkChannelOperationStatus status, nosResult result);
+
 typedef struct nosDeckLinkSubsystem {
 	void				(NOSAPI_CALL* GetDevices)(size_t *inoutCount, nosDeckLinkDeviceDesc* outDeviceDescriptors);
 	nosResult			(NOSAPI_CALL* GetAvailableChannels)(uint32_t deviceIndex, nosMediaIODirection direction, nosDeckLinkChannelList* outChannels);
@@ -118,6 +382,76 @@ typedef struct nosDeckLinkSubsystem {
 	///		- "Dual Link 1-2" -> "Dual Link 1-3"
 	nosResult			(NOSAPI_CALL* GetPortMappedChannelName)(uint32_t deviceIndex, nosDeckLinkChannel channel, char* outName, size_t maxSize);
 	nosDeckLinkChannel	(NOSAPI_CALL* GetChannelFromPortMappedName)(uint32_t deviceIndex, const char* portMappedChannelName);
+
+	/// Placement of the frame buffers of an open channel. Page size depends on the huge_pages option in Config/Settings.json
+	/// and on what the system could provide.
+	nosResult (NOSAPI_CALL* GetChannelFrameMemoryInfo)(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkChannelFrameMemoryInfo* outInfo);
+
+	/// Counters are kept from channel open. Reset to compare before/after a change, e.g. thread_scheduling in Config/Settings.json.
+	nosResult (NOSAPI_CALL* GetChannelStatistics)(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkChannelStatistics* outStatistics);
+	nosResult (NOSAPI_CALL* ResetChannelStatistics)(uint32_t deviceIndex, nosDeckLinkChannel channel);
+
+	/// Reads the audio that arrived with the video frame last read by DMATransfer, copying interleaved samples
+	/// from the capture ring into data. Pass null data to only query outInfo, e.g. to size the buffer.
+	/// Fails if audio is not enabled on the input channel, or if the samples are already overwritten.
+	nosResult (NOSAPI_CALL* ReadAudio)(uint32_t deviceIndex, nosDeckLinkChannel channel, void* data, size_t size, nosDeckLinkAudioPacketInfo* outInfo);
+	/// Queues interleaved samples for the next frame to be written with DMATransfer, so call it before DMATransfer.
+	/// Samples are scheduled at the stream time of that frame. A frame always gets exactly its share of 48 kHz
+	/// (e.g. 1601 or 1602 sample frames at 29.97), missing samples are filled with silence and extra ones are dropped.
+	nosResult (NOSAPI_CALL* WriteAudio)(uint32_t deviceIndex, nosDeckLinkChannel channel, const void* data, size_t size);
+	nosResult (NOSAPI_CALL* GetAudioOutputStatus)(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkAudioOutputStatus* outStatus);
+
+	/// VANC packets of the video frame last read by DMATransfer. Packets point into the channel's arena without copying,
+	/// and stay valid until the next DMATransfer or CloseChannel on the channel.
+	/// The channel must be opened with CaptureAncillaryPackets.
+	nosResult (NOSAPI_CALL* ReadAncillaryPackets)(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkAncillaryPacketList* outList);
+
+	/// Same as DMATransfer. For input channels, outInfo receives the stream time and timecodes of the frame that was read,
+	/// so frames can be aligned by timecode instead of arrival order. outInfo can be null.
+	/// Fails if no frame is available, outInfo is then left zeroed.
+	nosResult (NOSAPI_CALL* DMATransferWithInfo)(uint32_t deviceIndex, nosDeckLinkChannel channel, void* data, size_t size, nosDeckLinkFrameInfo* outInfo);
+	/// For output channels opened with a timecode mode. In manual mode, sets the timecode of the next frame written with DMATransfer.
+	/// In generate mode, the next scheduled frame gets this timecode and the following ones count up from it.
+	/// Frames above 30 fps count frame pairs with FieldMark set on the second one, except for the high frame rate format.
+	nosResult (NOSAPI_CALL* SetOutputTimecode)(uint32_t deviceIndex, nosDeckLinkChannel channel, const nosDeckLinkTimecode* timecode);
+
+	int32_t   (NOSAPI_CALL* RegisterInputVideoFormatChangeCallbackV2)(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkInputVideoFormatChangeCallbackV2 callback, void* userData);
+	nosResult (NOSAPI_CALL* UnregisterInputVideoFormatChangeCallbackV2)(uint32_t deviceIndex, nosDeckLinkChannel channel, int32_t callbackId);
+	/// HDR metadata attached to the following output frames. Frames are only updated when the metadata changes.
+	/// Set Present to false to stop sending HDR metadata.
+	nosResult (NOSAPI_CALL* SetOutputHDRMetadata)(uint32_t deviceIndex, nosDeckLinkChannel channel, const nosDeckLinkHDRMetadata* metadata);
+
+	/// For output channels opened with the internal or external hardware keyer. Level 255 is fully keyed, 0 shows only the background.
+	nosResult (NOSAPI_CALL* SetOutputKeyerLevel)(uint32_t deviceIndex, nosDeckLinkChannel channel, uint8_t level);
+	/// Fades the key in (up) or out over frameCount frames.
+	nosResult (NOSAPI_CALL* RampOutputKeyer)(uint32_t deviceIndex, nosDeckLinkChannel channel, bool up, uint32_t frameCount);
+
+	/// Non-blocking OpenChannel and CloseChannel. The operation runs on a worker owned by the device and reports its progress to callback,
+	/// which can be null. Operations on the same device run in the order they are queued, operations on different devices run concurrently.
+	/// Returns once the operation is queued, params are copied.
+	nosResult (NOSAPI_CALL* OpenChannelAsync)(uint32_t deviceIndex, const nosDeckLinkOpenChannelParams* params, nosDeckLinkChannelOperationCallback callback, void* userData);
+	nosResult (NOSAPI_CALL* CloseChannelAsync)(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkChannelOperationCallback callback, void* userData);
+
+	/// Switches an open output channel to another format without closing it. Frame result callbacks and the audio, timecode and keyer
+	/// settings of the channel are kept, and a running stream is restarted. Frames are reused when only the frame rate changes,
+	/// and their buffers are reused when the frame size stays the same. On failure the channel keeps its previous format if possible.
+	nosResult (NOSAPI_CALL* ReconfigureChannel)(uint32_t deviceIndex, nosDeckLinkChannel channel, nosMediaIOFrameGeometry geometry, nosMediaIOFrameRate frameRate, nosMediaIOPixelFormat pixelFormat);
+
+	/// Warm standby for an open, stopped output channel. Every frame of the channel is filled with black and scheduled, with silence
+	/// if audio is enabled, but playback is not started. Reconfiguring or closing the channel leaves standby.
+	nosResult (NOSAPI_CALL* PrerollStream)(uint32_t deviceIndex, nosDeckLinkChannel channel);
+	/// Starts playback of a prerolled channel on the next frame boundary. The black preroll goes out first, so the first frame written
+	/// with DMATransfer after activation is always displayed two frames after playback starts. Fails if the channel is not prerolled.
+	/// Fill and key of a FILL_KEY_PAIR are started within the first half of the same frame, so they start on the same boundary.
+	/// If the start calls still straddle a boundary, a warning is logged, since the SDK cannot start both at a common hardware time.
+	nosResult (NOSAPI_CALL* ActivateStream)(uint32_t deviceIndex, nosDeckLinkChannel channel);
+
+	/// Utilization of the frame buffer pool shared by all channels, see frame_memory.shared_pool in the settings.
+	/// Buffer counts stay zero if the shared pool is not enabled.
+	nosResult (NOSAPI_CALL* GetFramePoolUsage)(nosDeckLinkFramePoolUsage* outUsage);
+
+	/// Host memory held by the channels of a device, by purpose, with high watermarks. Memory inside the DeckLink driver is not included.
+	nosResult (NOSAPI_CALL* GetMemoryUsage)(uint32_t deviceIndex, nosDeckLinkDeviceMemoryUsage* outUsage);
 } nosDeckLinkSubsystem;
 
 #pragma region Helper Declarations & Macros
@@ -125,7 +459,7 @@ typedef struct nosDeckLinkSubsystem {
 // Make sure these are same with nossys file.
 #define NOS_DECKLINK_DEVICE_SUBSYSTEM_NAME "nos.sys.decklink"
 #define NOS_DECKLINK_DEVICE_SUBSYSTEM_VERSION_MAJOR 0
-#define NOS_DECKLINK_DEVICE_SUBSYSTEM_VERSION_MINOR 2
+#define NOS_DECKLINK_DEVICE_SUBSYSTEM_VERSION_MINOR 3
 
 extern struct nosModuleInfo nosDeckLinkSubsystemModuleInfo;
 extern nosDeckLinkSubsystem* nosDeckLink;
@@ -0,0 +1,110 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#include "Ancillary.hpp"
+
+#include <cstring>
+
+namespace nos::decklink
+{
+
+AncillaryArena::AncillaryArena(size_t packetCapacity, size_t payloadCapacity)
+	: Payload(payloadCapacity)
+{
+	Packets.reserve(packetCapacity);
+}
+
+void AncillaryArena::Clear()
+{
+	Packets.clear();
+	PayloadSize = 0;
+	DroppedCount = 0;
+	FrameTime = 0;
+}
+
+void AncillaryArena::Gather(IDeckLinkVideoFrame* frame)
+{
+	IDeckLinkVideoFrameAncillaryPackets* ancillaryPackets = nullptr;
+	if (frame->QueryInterface(IID_IDeckLinkVideoFrameAncillaryPackets, (void**)&ancillaryPackets) != S_OK || !ancillaryPackets)
+		return;
+	IDeckLinkAncillaryPacketIterator* iterator = nullptr;
+	if (ancillaryPackets->GetPacketIterator(&iterator) == S_OK && iterator)
+	{
+		IDeckLinkAncillaryPacket* packet = nullptr;
+		while (iterator->Next(&packet) == S_OK && packet)
+		{
+			const void* data = nullptr;
+			uint32_t size = 0;
+			if (packet->GetBytes(bmdAncillaryPacketFormatUInt8, &data, &size) == S_OK)
+			{
+				if (Packets.size() == Packets.capacity() || Payload.size() - PayloadSize < size)
+					++DroppedCount;
+				else
+				{
+					uint8_t* payload = Payload.data() + PayloadSize;
+					std::memcpy(payload, data, size);
+					PayloadSize += size;
+					Packets.push_back(nosDeckLinkAncillaryPacket{
+						.Data = payload,
+						.Size = size,
+						.Line = packet->GetLineNumber(),
+						.DID = packet->GetDID(),
+						.SDID = packet->GetSDID(),
+						.DataStreamIndex = packet->GetDataStreamIndex(),
+					});
+				}
+			}
+			Release(packet);
+		}
+		Release(iterator);
+	}
+	Release(ancillaryPackets);
+}
+
+void AncillaryArenaPool::Recycler::operator()(AncillaryArena* arena) const
+{
+	arena->Clear();
+	std::unique_lock lock(Pool->Mutex);
+	Pool->FreeArenas.push_back(arena);
+}
+
+void AncillaryArenaPool::Allocate(size_t arenaCount, size_t packetCapacity, size_t payloadCapacity)
+{
+	std::unique_lock lock(Mutex);
+	if (!Arenas.empty())
+		return;
+	for (size_t i = 0; i < arenaCount; ++i)
+	{
+		Arenas.push_back(std::make_unique<AncillaryArena>(packetCapacity, payloadCapacity));
+		FreeArenas.push_back(Arenas.back().get());
+	}
+}
+
+bool AncillaryArenaPool::Free()
+{
+	std::unique_lock lock(Mutex);
+	if (FreeArenas.size() != Arenas.size())
+		return false;
+	FreeArenas.clear();
+	Arenas.clear();
+	return true;
+}
+
+AncillaryArenaPool::Handle AncillaryArenaPool::Acquire()
+{
+	std::unique_lock lock(Mutex);
+	if (FreeArenas.empty())
+		return Handle(nullptr, Recycler{this});
+	auto* arena = FreeArenas.back();
+	FreeArenas.pop_back();
+	return Handle(arena, Recycler{this});
+}
+
+size_t AncillaryArenaPool::GetMemorySize()
+{
+	std::unique_lock lock(Mutex);
+	size_t size = 0;
+	for (auto& arena : Arenas)
+		size += arena->Packets.capacity() * sizeof(nosDeckLinkAncillaryPacket) + arena->Payload.size();
+	return size;
+}
+
+}
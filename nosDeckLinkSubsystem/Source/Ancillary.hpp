@@ -0,0 +1,57 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Common.hpp"
+
+namespace nos::decklink
+{
+
+/// VANC packets of a single frame. Storage is reserved up front and never reallocated,
+/// so packet data pointers stay valid until the arena is cleared.
+struct AncillaryArena
+{
+	AncillaryArena(size_t packetCapacity, size_t payloadCapacity);
+
+	void Clear();
+	/// Copies every packet of the frame into the arena. Packets that don't fit are counted as dropped.
+	void Gather(IDeckLinkVideoFrame* frame);
+
+	std::vector<nosDeckLinkAncillaryPacket> Packets;
+	std::vector<uint8_t> Payload;
+	size_t PayloadSize = 0;
+	uint32_t DroppedCount = 0;
+	BMDTimeValue FrameTime = 0;
+};
+
+/// Fixed set of arenas shared by the frames of an input channel. Arenas go back to the pool once
+/// the frame holding them is read or discarded.
+class AncillaryArenaPool
+{
+public:
+	struct Recycler
+	{
+		AncillaryArenaPool* Pool;
+		void operator()(AncillaryArena* arena) const;
+	};
+	using Handle = std::unique_ptr<AncillaryArena, Recycler>;
+
+	/// Allocates the arenas on first use. Later calls are no-ops until the arenas are freed.
+	void Allocate(size_t arenaCount, size_t packetCapacity, size_t payloadCapacity);
+	/// Frees the arenas unless frames still hold some of them. Returns whether the pool is empty.
+	bool Free();
+	/// Null if every arena is in use.
+	Handle Acquire();
+	/// Bytes reserved by all arenas.
+	size_t GetMemorySize();
+
+protected:
+	std::mutex Mutex;
+	std::vector<std::unique_ptr<AncillaryArena>> Arenas;
+	std::vector<AncillaryArena*> FreeArenas;
+};
+
+}
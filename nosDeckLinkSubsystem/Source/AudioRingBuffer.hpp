@@ -0,0 +1,87 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace nos::decklink
+{
+
+/// Single producer byte ring for audio samples. Memory is allocated up front, so writing never blocks or allocates.
+/// Data is addressed by stream position (bytes written since Reset). Readers copy ranges out without locking,
+/// and are told if the writer overwrote the range while they were copying it.
+class AudioRingBuffer
+{
+public:
+	/// Not thread-safe, call while the producer is stopped.
+	void Allocate(size_t capacity)
+	{
+		if (capacity != Capacity)
+		{
+			Data = std::make_unique<uint8_t[]>(capacity); // Value-initialized, so pages are already faulted in.
+			Capacity = capacity;
+		}
+		Reset();
+	}
+
+	/// Not thread-safe, call while the producer is stopped.
+	void Free()
+	{
+		Data.reset();
+		Capacity = 0;
+		Reset();
+	}
+
+	/// Not thread-safe, call while the producer is stopped.
+	void Reset()
+	{
+		WritePosition.store(0, std::memory_order_relaxed);
+		ReservedPosition.store(0, std::memory_order_relaxed);
+	}
+
+	size_t GetCapacity() const { return Capacity; }
+	uint64_t GetWritePosition() const { return WritePosition.load(std::memory_order_acquire); }
+
+	/// Producer only. Returns the stream position of the first byte written.
+	/// Anything beyond capacity is dropped.
+	uint64_t Write(const void* data, size_t size)
+	{
+		uint64_t position = WritePosition.load(std::memory_order_relaxed);
+		if (size > Capacity)
+			size = Capacity;
+		// Readers check this after copying, so it must be visible before the bytes are overwritten.
+		ReservedPosition.store(position + size, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		size_t offset = position % Capacity;
+		size_t first = std::min(size, Capacity - offset);
+		std::memcpy(Data.get() + offset, data, first);
+		std::memcpy(Data.get(), static_cast<const uint8_t*>(data) + first, size - first);
+		WritePosition.store(position + size, std::memory_order_release);
+		return position;
+	}
+
+	/// Copies [position, position + size) to dest. Returns false if the range is not written yet
+	/// or if it is not in the ring anymore, in which case dest contents are undefined.
+	bool Read(uint64_t position, void* dest, size_t size) const
+	{
+		if (size > Capacity || position + size > WritePosition.load(std::memory_order_acquire))
+			return false;
+		size_t offset = position % Capacity;
+		size_t first = std::min(size, Capacity - offset);
+		std::memcpy(dest, Data.get() + offset, first);
+		std::memcpy(static_cast<uint8_t*>(dest) + first, Data.get(), size - first);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return ReservedPosition.load(std::memory_order_relaxed) <= position + Capacity;
+	}
+
+protected:
+	std::unique_ptr<uint8_t[]> Data;
+	size_t Capacity = 0;
+	std::atomic_uint64_t WritePosition = 0;
+	std::atomic_uint64_t ReservedPosition = 0;
+};
+
+}
@@ -0,0 +1,157 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#include "CallbackDispatcher.hpp"
+#include "Numa.hpp"
+
+#include <Nodos/Modules.h>
+
+namespace nos::decklink
+{
+
+constexpr size_t CALLBACK_QUEUE_CAPACITY = 1024;
+
+CallbackDispatcher::CallbackDispatcher()
+	: Queue(CALLBACK_QUEUE_CAPACITY)
+{
+	Thread = std::thread([this] { Run(); });
+}
+
+CallbackDispatcher::~CallbackDispatcher()
+{
+	ShouldExit = true;
+	++Signal;
+	Signal.notify_one();
+	if (Thread.joinable())
+		Thread.join();
+}
+
+void CallbackDispatcher::PostFrameResult(std::shared_ptr<ChannelCallbacks> const& target, nosDeckLinkFrameResult result, uint32_t frameNumber)
+{
+	CallbackEvent event{.EventType = CallbackEvent::Type::FrameResult, .PostTime = std::chrono::steady_clock::now(), .Target = target, .Result = result, .FrameNumber = frameNumber};
+	if (result == NOS_DECKLINK_FRAME_DROPPED)
+	{
+		if (target->LastPostWasDrop)
+		{
+			// Merge into the drop event that is still waiting in the queue, if there is one.
+			auto run = target->DropRun.load(std::memory_order_acquire);
+			while (run != 0 && !(run & ChannelCallbacks::DropRunClosed))
+				if (target->DropRun.compare_exchange_weak(run, run + 1, std::memory_order_acq_rel))
+					return;
+		}
+		target->LastPostWasDrop = true;
+		uint32_t noRun = 0;
+		event.Coalesced = target->DropRun.compare_exchange_strong(noRun, 1, std::memory_order_acq_rel);
+		bool coalesced = event.Coalesced;
+		if (!Post(std::move(event)) && coalesced)
+			target->DropRun.store(0, std::memory_order_release);
+		return;
+	}
+	if (target->LastPostWasDrop)
+	{
+		auto run = target->DropRun.load(std::memory_order_acquire);
+		while (run != 0 && !(run & ChannelCallbacks::DropRunClosed))
+			if (target->DropRun.compare_exchange_weak(run, run | ChannelCallbacks::DropRunClosed, std::memory_order_acq_rel))
+				break;
+		target->LastPostWasDrop = false;
+	}
+	Post(std::move(event));
+}
+
+void CallbackDispatcher::PostInputVideoFormatChanged(std::shared_ptr<ChannelCallbacks> const& target, nosDeckLinkInputVideoFormat const& format, bool videoModeChanged)
+{
+	Post(CallbackEvent{
+		.EventType = CallbackEvent::Type::InputVideoFormatChanged,
+		.Target = target,
+		.Format = format,
+		.VideoModeChanged = videoModeChanged
+	});
+}
+
+bool CallbackDispatcher::IsDispatchThread() const
+{
+	return std::this_thread::get_id() == Thread.get_id();
+}
+
+bool CallbackDispatcher::SetNumaAffinity(int32_t numaNode)
+{
+	if (!SetThreadNumaAffinity(Thread, numaNode))
+		return false;
+	NumaNode = numaNode;
+	return true;
+}
+
+bool CallbackDispatcher::Post(CallbackEvent&& event)
+{
+	if (!Queue.TryPush(std::move(event)))
+	{
+		++OverflowCount;
+		return false;
+	}
+	Signal.fetch_add(1, std::memory_order_release);
+	Signal.notify_one();
+	return true;
+}
+
+void CallbackDispatcher::Run()
+{
+	while (!ShouldExit)
+	{
+		auto signal = Signal.load(std::memory_order_acquire);
+		CallbackEvent event;
+		while (Queue.TryPop(event))
+		{
+			Dispatch(event);
+			event = {};
+		}
+		if (auto overflowCount = OverflowCount.exchange(0))
+			nosEngine.LogW("DeckLink: Callback queue is full, %u events are discarded", overflowCount);
+		Signal.wait(signal, std::memory_order_acquire);
+	}
+}
+
+void CallbackDispatcher::Dispatch(CallbackEvent& event)
+{
+	auto& target = *event.Target;
+	switch (event.EventType)
+	{
+	case CallbackEvent::Type::FrameResult: {
+		auto latencyNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - event.PostTime).count();
+		if (auto frameIntervalNs = target.FrameIntervalNs.load(); frameIntervalNs > 0 && latencyNs > (uint64_t)frameIntervalNs)
+			++target.CallbackDeadlinesMissed;
+		auto maxLatencyNs = target.MaxCallbackLatencyNs.load();
+		while (latencyNs > maxLatencyNs && !target.MaxCallbackLatencyNs.compare_exchange_weak(maxLatencyNs, latencyNs))
+			;
+		auto frameNumber = event.FrameNumber;
+		if (event.Coalesced)
+		{
+			// Coalesced drops are consecutive frames, report the last one.
+			auto dropCount = target.DropRun.exchange(0, std::memory_order_acq_rel) & ~ChannelCallbacks::DropRunClosed;
+			if (dropCount > 1)
+				frameNumber += dropCount - 1;
+		}
+		target.FrameResult.Invoke(event.Result, frameNumber);
+		break;
+	}
+	case CallbackEvent::Type::InputVideoFormatChanged: {
+		if (event.VideoModeChanged)
+			target.VideoFormatChange.Invoke(event.Format.Geometry, event.Format.FrameRate, event.Format.PixelFormat);
+		target.VideoFormatChangeV2.Invoke(&event.Format);
+		break;
+	}
+	}
+}
+
+CallbackDispatcher* CallbackDispatcher::Instance()
+{
+	if (!SingleInstance)
+		SingleInstance = new CallbackDispatcher;
+	return SingleInstance;
+}
+
+void CallbackDispatcher::Destroy()
+{
+	delete SingleInstance;
+	SingleInstance = nullptr;
+}
+
+CallbackDispatcher* CallbackDispatcher::SingleInstance = nullptr;
+}
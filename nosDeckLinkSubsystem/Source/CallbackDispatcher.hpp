@@ -0,0 +1,88 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "nosDeckLinkSubsystem/nosDeckLinkSubsystem.h"
+#include "CallbackList.hpp"
+#include "LockFreeQueue.hpp"
+
+namespace nos::decklink
+{
+
+/// Callbacks registered to a single I/O handler. Queued events keep this alive, so a handler can go away
+/// while its events are still waiting to be dispatched.
+struct ChannelCallbacks
+{
+	CallbackList<nosDeckLinkFrameResultCallback> FrameResult;
+	CallbackList<nosDeckLinkInputVideoFormatChangeCallback> VideoFormatChange;
+	CallbackList<nosDeckLinkInputVideoFormatChangeCallbackV2> VideoFormatChangeV2;
+
+	// Drop coalescing. 0: No drop event waiting in the queue, otherwise number of drops the waiting event represents.
+	// Closed bit is set once a non-drop event is posted after it, so later drops can't be merged into it.
+	static constexpr uint32_t DropRunClosed = 0x80000000u;
+	std::atomic_uint32_t DropRun = 0;
+	bool LastPostWasDrop = false; // Only touched by the DeckLink thread posting the events.
+
+	// Frame result callbacks starting later than a frame interval after the event count as missed deadlines.
+	std::atomic_int64_t FrameIntervalNs = 0;
+	std::atomic_uint64_t CallbackDeadlinesMissed = 0;
+	std::atomic_uint64_t MaxCallbackLatencyNs = 0;
+};
+
+struct CallbackEvent
+{
+	enum class Type : uint8_t
+	{
+		FrameResult,
+		InputVideoFormatChanged,
+	};
+	Type EventType = Type::FrameResult;
+	bool Coalesced = false;
+	std::chrono::steady_clock::time_point PostTime;
+	std::shared_ptr<ChannelCallbacks> Target;
+	// FrameResult
+	nosDeckLinkFrameResult Result = NOS_DECKLINK_FRAME_COMPLETED;
+	uint32_t FrameNumber = 0;
+	// InputVideoFormatChanged
+	nosDeckLinkInputVideoFormat Format{};
+	bool VideoModeChanged = false; // Otherwise only metadata changed, which is reported to V2 callbacks only.
+};
+
+/// Runs user callbacks on a subsystem-owned thread, so that slow subscribers can't hold up the DeckLink callback threads.
+/// Posting is lock-free and allocation-free.
+class CallbackDispatcher
+{
+public:
+	static CallbackDispatcher* Instance();
+	static void Destroy();
+	~CallbackDispatcher();
+
+	void PostFrameResult(std::shared_ptr<ChannelCallbacks> const& target, nosDeckLinkFrameResult result, uint32_t frameNumber);
+	void PostInputVideoFormatChanged(std::shared_ptr<ChannelCallbacks> const& target, nosDeckLinkInputVideoFormat const& format, bool videoModeChanged);
+
+	bool IsDispatchThread() const;
+	bool SetNumaAffinity(int32_t numaNode);
+	int32_t GetNumaNode() const { return NumaNode; }
+	std::thread& GetThread() { return Thread; }
+
+protected:
+	bool Post(CallbackEvent&& event);
+	void Run();
+	void Dispatch(CallbackEvent& event);
+
+	LockFreeQueue<CallbackEvent> Queue;
+	std::atomic_uint32_t Signal = 0;
+	std::atomic_bool ShouldExit = false;
+	std::atomic_uint32_t OverflowCount = 0;
+	std::atomic_int32_t NumaNode = -1; // Node the thread is pinned to
+	std::thread Thread;
+private:
+	CallbackDispatcher();
+	static CallbackDispatcher* SingleInstance;
+};
+
+}
@@ -0,0 +1,116 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nos::decklink
+{
+
+/// Number of CallbackList::Invoke calls the current thread is inside of.
+inline thread_local uint32_t CallbackListInvokeDepth = 0;
+
+/// Copy-on-write callback registry. Invoke reads the current snapshot without taking a lock or waiting, and no lock is
+/// held while user callbacks run. Add/Remove copy the list, publish the copy and then wait until no reader can still be
+/// using the old one, so once Remove returns the removed callback is neither running nor going to be called.
+/// (Except when Remove is called from inside a callback, then the old snapshot is freed by a later write.)
+template <typename Callback>
+class CallbackList
+{
+public:
+	struct Entry
+	{
+		int32_t Id;
+		Callback Function;
+		void* UserData;
+	};
+	using Snapshot = std::vector<Entry>;
+
+	CallbackList() = default;
+	CallbackList(const CallbackList&) = delete;
+	CallbackList& operator=(const CallbackList&) = delete;
+
+	~CallbackList()
+	{
+		delete Current.load();
+		for (auto* snapshot : Retired)
+			delete snapshot;
+	}
+
+	int32_t Add(Callback callback, void* userData)
+	{
+		std::unique_lock lock(WriterMutex);
+		auto callbackId = NextId++;
+		auto* next = new Snapshot(*Current.load());
+		next->push_back({callbackId, callback, userData});
+		Publish(next);
+		return callbackId;
+	}
+
+	bool Remove(int32_t callbackId)
+	{
+		std::unique_lock lock(WriterMutex);
+		auto* current = Current.load();
+		auto* next = new Snapshot;
+		next->reserve(current->size());
+		for (auto& entry : *current)
+			if (entry.Id != callbackId)
+				next->push_back(entry);
+		if (next->size() == current->size())
+		{
+			delete next;
+			return false;
+		}
+		Publish(next);
+		return true;
+	}
+
+	template <typename... Args>
+	void Invoke(Args... args)
+	{
+		++CallbackListInvokeDepth;
+		ActiveReaders.fetch_add(1);
+		auto* snapshot = Current.load();
+		for (auto& entry : *snapshot)
+			entry.Function(entry.UserData, args...);
+		ActiveReaders.fetch_sub(1);
+		--CallbackListInvokeDepth;
+	}
+
+	bool Empty()
+	{
+		ActiveReaders.fetch_add(1);
+		bool empty = Current.load()->empty();
+		ActiveReaders.fetch_sub(1);
+		return empty;
+	}
+
+protected:
+	void Publish(Snapshot* next)
+	{
+		auto* old = Current.exchange(next);
+		if (CallbackListInvokeDepth)
+		{
+			// Called from inside a callback, waiting for readers would wait for ourselves.
+			Retired.push_back(old);
+			return;
+		}
+		// Grace period: Readers that can still see the old snapshot have registered before the exchange.
+		while (ActiveReaders.load() != 0)
+			std::this_thread::yield();
+		delete old;
+		for (auto* snapshot : Retired)
+			delete snapshot;
+		Retired.clear();
+	}
+
+	std::atomic<Snapshot*> Current = new Snapshot;
+	std::atomic_uint32_t ActiveReaders = 0;
+	std::mutex WriterMutex;
+	std::vector<Snapshot*> Retired;
+	int32_t NextId = 0;
+};
+
+}
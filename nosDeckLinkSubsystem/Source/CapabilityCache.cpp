@@ -0,0 +1,123 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#include "CapabilityCache.hpp"
+
+#include <fstream>
+
+namespace nos::decklink
+{
+
+void CapabilityCacheFile::Load(std::filesystem::path path, std::optional<int64_t> driverVersion)
+{
+	std::unique_lock lock(Mutex);
+	Path.clear();
+	Cache = {};
+	if (!driverVersion)
+	{
+		nosEngine.LogW("CapabilityCache: Driver version is unknown, capabilities will be probed on every start.");
+		return;
+	}
+	Path = std::move(path);
+	Cache.driver_version = *driverVersion;
+
+	std::ifstream file(Path, std::ios::binary);
+	if (!file)
+		return;
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	flatbuffers::Verifier verifier(data.data(), data.size());
+	if (!sys::decklink::VerifyCapabilityCacheBuffer(verifier))
+	{
+		nosEngine.LogW("CapabilityCache: %s is corrupt, capabilities will be probed again.", Path.string().c_str());
+		return;
+	}
+	sys::decklink::TCapabilityCache loaded;
+	sys::decklink::GetCapabilityCache(data.data())->UnPackTo(&loaded);
+	if (loaded.driver_version != *driverVersion)
+	{
+		nosEngine.LogI("CapabilityCache: Driver version changed, capabilities will be probed again.");
+		return;
+	}
+	Cache = std::move(loaded);
+	nosEngine.LogI("CapabilityCache: Loaded capabilities of %zu sub-devices from %s", Cache.sub_devices.size(), Path.string().c_str());
+}
+
+std::optional<OutputVideoFormatsByFlags> CapabilityCacheFile::Find(std::string const& modelName, int64_t persistentId, int64_t profileId)
+{
+	std::unique_lock lock(Mutex);
+	if (Path.empty())
+		return std::nullopt;
+	for (auto& entry : Cache.sub_devices)
+	{
+		if (entry->model_name != modelName || entry->persistent_id != persistentId || entry->profile_id != profileId)
+			continue;
+		OutputVideoFormatsByFlags formatsByFlags;
+		for (auto& cachedFormats : entry->output_video_formats)
+		{
+			auto& formats = formatsByFlags[cachedFormats->video_mode_flags];
+			for (auto& format : cachedFormats->formats)
+			{
+				auto fg = static_cast<nosMediaIOFrameGeometry>(format.frame_geometry());
+				auto frameRate = static_cast<nosMediaIOFrameRate>(format.frame_rate());
+				formats[fg][frameRate].insert(static_cast<nosMediaIOPixelFormat>(format.pixel_format()));
+			}
+		}
+		return formatsByFlags;
+	}
+	return std::nullopt;
+}
+
+void CapabilityCacheFile::Store(std::string const& modelName, int64_t persistentId, int64_t profileId, OutputVideoFormatsByFlags const& formats)
+{
+	auto entry = std::make_unique<sys::decklink::TCachedSubDeviceCapabilities>();
+	entry->model_name = modelName;
+	entry->persistent_id = persistentId;
+	entry->profile_id = profileId;
+	for (auto& [flags, formatsOfFlags] : formats)
+	{
+		auto cachedFormats = std::make_unique<sys::decklink::TCachedOutputVideoFormats>();
+		cachedFormats->video_mode_flags = flags;
+		for (auto& [fg, frameRates] : formatsOfFlags)
+			for (auto& [frameRate, pixelFormats] : frameRates)
+				for (auto pixelFormat : pixelFormats)
+					cachedFormats->formats.emplace_back(fg, frameRate, pixelFormat);
+		entry->output_video_formats.push_back(std::move(cachedFormats));
+	}
+
+	std::unique_lock lock(Mutex);
+	if (Path.empty())
+		return;
+	std::erase_if(Cache.sub_devices, [&](auto const& cached) {
+		return cached->model_name == modelName && cached->persistent_id == persistentId && cached->profile_id == profileId;
+	});
+	Cache.sub_devices.push_back(std::move(entry));
+	Save();
+}
+
+bool CapabilityCacheFile::Save()
+{
+	flatbuffers::FlatBufferBuilder fbb;
+	sys::decklink::FinishCapabilityCacheBuffer(fbb, sys::decklink::CreateCapabilityCache(fbb, &Cache));
+
+	// Written next to the cache and renamed over it, so a crash does not leave a truncated cache behind.
+	auto tempPath = Path;
+	tempPath += ".tmp";
+	std::error_code ec;
+	std::filesystem::create_directories(Path.parent_path(), ec);
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.write(reinterpret_cast<const char*>(fbb.GetBufferPointer()), fbb.GetSize()))
+		{
+			nosEngine.LogW("CapabilityCache: Failed to write %s", tempPath.string().c_str());
+			return false;
+		}
+	}
+	std::filesystem::rename(tempPath, Path, ec);
+	if (ec)
+	{
+		nosEngine.LogW("CapabilityCache: Failed to replace %s: %s", Path.string().c_str(), ec.message().c_str());
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
+
+}
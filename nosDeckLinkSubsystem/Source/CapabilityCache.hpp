@@ -0,0 +1,41 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include "Common.hpp"
+
+#include <nosMediaIO/nosMediaIO.h>
+
+#include "CapabilityCache_generated.h"
+
+namespace nos::decklink
+{
+using OutputVideoFormats = std::map<nosMediaIOFrameGeometry, std::map<nosMediaIOFrameRate, std::set<nosMediaIOPixelFormat>>>;
+using OutputVideoFormatsByFlags = std::unordered_map<BMDSupportedVideoModeFlags, OutputVideoFormats>;
+
+/// Probed capabilities of sub-devices, kept on disk between runs.
+/// Entries are keyed by model name, persistent ID and profile. The whole cache is dropped once the driver version changes.
+class CapabilityCacheFile
+{
+public:
+	/// Without a driver version the cache is disabled, nothing is read or written.
+	void Load(std::filesystem::path path, std::optional<int64_t> driverVersion);
+	std::optional<OutputVideoFormatsByFlags> Find(std::string const& modelName, int64_t persistentId, int64_t profileId);
+	/// Replaces the entry of the sub-device and writes the cache to disk.
+	void Store(std::string const& modelName, int64_t persistentId, int64_t profileId, OutputVideoFormatsByFlags const& formats);
+protected:
+	bool Save();
+
+	std::mutex Mutex;
+	std::filesystem::path Path;
+	sys::decklink::TCapabilityCache Cache;
+};
+
+}
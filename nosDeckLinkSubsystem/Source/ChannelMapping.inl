@@ -29,12 +29,29 @@ inline const ConnectorMap& GetChannelMap()
 	if (!map.empty())
 		return map;
 
-	// TODO: Currently, only half-duplex profiles are included, add other profiles too.
 	auto& deckLink8KPro = map["DeckLink 8K Pro"] = {};
 	deckLink8KPro[bmdProfileFourSubDevicesHalfDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
 	deckLink8KPro[bmdProfileFourSubDevicesHalfDuplex][1][NOS_DECKLINK_CHANNEL_SINGLE_LINK_3] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
 	deckLink8KPro[bmdProfileFourSubDevicesHalfDuplex][2][NOS_DECKLINK_CHANNEL_SINGLE_LINK_2] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
 	deckLink8KPro[bmdProfileFourSubDevicesHalfDuplex][3][NOS_DECKLINK_CHANNEL_SINGLE_LINK_4] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	// Multi-link channels start at the first SDI port of their sub-device, which can still drive it as a single link.
+	deckLink8KPro[bmdProfileTwoSubDevicesHalfDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLink8KPro[bmdProfileTwoSubDevicesHalfDuplex][0][NOS_DECKLINK_CHANNEL_DUAL_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLink8KPro[bmdProfileTwoSubDevicesHalfDuplex][1][NOS_DECKLINK_CHANNEL_SINGLE_LINK_3] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLink8KPro[bmdProfileTwoSubDevicesHalfDuplex][1][NOS_DECKLINK_CHANNEL_DUAL_LINK_2] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLink8KPro[bmdProfileOneSubDeviceHalfDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLink8KPro[bmdProfileOneSubDeviceHalfDuplex][0][NOS_DECKLINK_CHANNEL_DUAL_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLink8KPro[bmdProfileOneSubDeviceHalfDuplex][0][NOS_DECKLINK_CHANNEL_QUAD_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLink8KPro[bmdProfileOneSubDeviceHalfDuplex][0][NOS_DECKLINK_CHANNEL_QUAD_LINK_SQUARE_DIVISION_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	// Full-duplex sub-devices capture on their first SDI port and play out on the next one.
+	deckLink8KPro[bmdProfileTwoSubDevicesFullDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT};
+	deckLink8KPro[bmdProfileTwoSubDevicesFullDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_2] = {NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLink8KPro[bmdProfileTwoSubDevicesFullDuplex][1][NOS_DECKLINK_CHANNEL_SINGLE_LINK_3] = {NOS_MEDIAIO_DIRECTION_INPUT};
+	deckLink8KPro[bmdProfileTwoSubDevicesFullDuplex][1][NOS_DECKLINK_CHANNEL_SINGLE_LINK_4] = {NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLink8KPro[bmdProfileOneSubDeviceFullDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT};
+	deckLink8KPro[bmdProfileOneSubDeviceFullDuplex][0][NOS_DECKLINK_CHANNEL_DUAL_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT};
+	deckLink8KPro[bmdProfileOneSubDeviceFullDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_3] = {NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLink8KPro[bmdProfileOneSubDeviceFullDuplex][0][NOS_DECKLINK_CHANNEL_DUAL_LINK_2] = {NOS_MEDIAIO_DIRECTION_OUTPUT};
 
 	auto& deckLinkQuad2 = map["DeckLink Quad 2"] = {};
 	deckLinkQuad2[bmdProfileFourSubDevicesHalfDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
@@ -45,12 +62,40 @@ inline const ConnectorMap& GetChannelMap()
 	deckLinkQuad2[bmdProfileFourSubDevicesHalfDuplex][5][NOS_DECKLINK_CHANNEL_SINGLE_LINK_4] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
 	deckLinkQuad2[bmdProfileFourSubDevicesHalfDuplex][6][NOS_DECKLINK_CHANNEL_SINGLE_LINK_6] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
 	deckLinkQuad2[bmdProfileFourSubDevicesHalfDuplex][7][NOS_DECKLINK_CHANNEL_SINGLE_LINK_8] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesHalfDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesHalfDuplex][0][NOS_DECKLINK_CHANNEL_DUAL_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesHalfDuplex][1][NOS_DECKLINK_CHANNEL_SINGLE_LINK_3] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesHalfDuplex][1][NOS_DECKLINK_CHANNEL_DUAL_LINK_2] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesHalfDuplex][2][NOS_DECKLINK_CHANNEL_SINGLE_LINK_5] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesHalfDuplex][2][NOS_DECKLINK_CHANNEL_DUAL_LINK_3] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesHalfDuplex][3][NOS_DECKLINK_CHANNEL_SINGLE_LINK_7] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesHalfDuplex][3][NOS_DECKLINK_CHANNEL_DUAL_LINK_4] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileOneSubDeviceHalfDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileOneSubDeviceHalfDuplex][0][NOS_DECKLINK_CHANNEL_DUAL_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileOneSubDeviceHalfDuplex][0][NOS_DECKLINK_CHANNEL_QUAD_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileOneSubDeviceHalfDuplex][0][NOS_DECKLINK_CHANNEL_QUAD_LINK_SQUARE_DIVISION_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileOneSubDeviceHalfDuplex][1][NOS_DECKLINK_CHANNEL_SINGLE_LINK_5] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileOneSubDeviceHalfDuplex][1][NOS_DECKLINK_CHANNEL_DUAL_LINK_3] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileOneSubDeviceHalfDuplex][1][NOS_DECKLINK_CHANNEL_QUAD_LINK_2] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileOneSubDeviceHalfDuplex][1][NOS_DECKLINK_CHANNEL_QUAD_LINK_SQUARE_DIVISION_2] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesFullDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesFullDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_2] = {NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesFullDuplex][1][NOS_DECKLINK_CHANNEL_SINGLE_LINK_3] = {NOS_MEDIAIO_DIRECTION_INPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesFullDuplex][1][NOS_DECKLINK_CHANNEL_SINGLE_LINK_4] = {NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesFullDuplex][2][NOS_DECKLINK_CHANNEL_SINGLE_LINK_5] = {NOS_MEDIAIO_DIRECTION_INPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesFullDuplex][2][NOS_DECKLINK_CHANNEL_SINGLE_LINK_6] = {NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesFullDuplex][3][NOS_DECKLINK_CHANNEL_SINGLE_LINK_7] = {NOS_MEDIAIO_DIRECTION_INPUT};
+	deckLinkQuad2[bmdProfileTwoSubDevicesFullDuplex][3][NOS_DECKLINK_CHANNEL_SINGLE_LINK_8] = {NOS_MEDIAIO_DIRECTION_OUTPUT};
 
 	auto& deckLinkDuo2 = map["DeckLink Duo 2"] = {};
 	deckLinkDuo2[bmdProfileTwoSubDevicesHalfDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
 	deckLinkDuo2[bmdProfileTwoSubDevicesHalfDuplex][1][NOS_DECKLINK_CHANNEL_SINGLE_LINK_3] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
 	deckLinkDuo2[bmdProfileTwoSubDevicesHalfDuplex][2][NOS_DECKLINK_CHANNEL_SINGLE_LINK_2] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
 	deckLinkDuo2[bmdProfileTwoSubDevicesHalfDuplex][3][NOS_DECKLINK_CHANNEL_SINGLE_LINK_4] = {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkDuo2[bmdProfileTwoSubDevicesFullDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_1] = {NOS_MEDIAIO_DIRECTION_INPUT};
+	deckLinkDuo2[bmdProfileTwoSubDevicesFullDuplex][0][NOS_DECKLINK_CHANNEL_SINGLE_LINK_2] = {NOS_MEDIAIO_DIRECTION_OUTPUT};
+	deckLinkDuo2[bmdProfileTwoSubDevicesFullDuplex][1][NOS_DECKLINK_CHANNEL_SINGLE_LINK_3] = {NOS_MEDIAIO_DIRECTION_INPUT};
+	deckLinkDuo2[bmdProfileTwoSubDevicesFullDuplex][1][NOS_DECKLINK_CHANNEL_SINGLE_LINK_4] = {NOS_MEDIAIO_DIRECTION_OUTPUT};
 	return map;
 }
 	
@@ -13,11 +13,14 @@
 // stl
 #include <functional>
 #include <optional>
+#include <array>
 #include <atomic>
+#include <memory>
 #include <chrono>
 #include <string>
 
 #include "nosDeckLinkSubsystem/nosDeckLinkSubsystem.h"
+#include "CallbackDispatcher.hpp"
 
 #include <Nodos/Modules.h>
 
@@ -67,6 +70,26 @@ inline HRESULT GetDeckLinkIterator(IDeckLinkIterator **deckLinkIterator)
 
 	return result;
 }
+inline HRESULT GetDeckLinkDiscovery(IDeckLinkDiscovery **deckLinkDiscovery)
+{
+	HRESULT result = CoCreateInstance(CLSID_CDeckLinkDiscovery, NULL, CLSCTX_ALL, IID_IDeckLinkDiscovery, (void**)deckLinkDiscovery);
+	if (FAILED(result))
+		nosEngine.LogE("A DeckLink discovery instance could not be created. The DeckLink drivers may not be installed.");
+
+	return result;
+}
+inline std::optional<int64_t> GetDeckLinkAPIVersion()
+{
+	IDeckLinkAPIInformation* apiInformation = nullptr;
+	if (FAILED(CoCreateInstance(CLSID_CDeckLinkAPIInformation, NULL, CLSCTX_ALL, IID_IDeckLinkAPIInformation, (void**)&apiInformation)) || !apiInformation)
+		return std::nullopt;
+	int64_t version = 0;
+	auto res = apiInformation->GetInt(BMDDeckLinkAPIVersion, &version);
+	apiInformation->Release();
+	if (res != S_OK)
+		return std::nullopt;
+	return version;
+}
 #else
 #define dlbool_t	bool
 #define dlstring_t	const char*
@@ -89,8 +112,55 @@ inline HRESULT GetDeckLinkIterator(IDeckLinkIterator **deckLinkIterator)
 
 	return result;
 }
+inline HRESULT GetDeckLinkDiscovery(IDeckLinkDiscovery **deckLinkDiscovery)
+{
+	*deckLinkDiscovery = CreateDeckLinkDiscoveryInstance();
+	if (*deckLinkDiscovery == NULL)
+	{
+		nosEngine.LogE("A DeckLink discovery instance could not be created. The DeckLink drivers may not be installed.");
+		return E_FAIL;
+	}
+	return S_OK;
+}
+inline std::optional<int64_t> GetDeckLinkAPIVersion()
+{
+	IDeckLinkAPIInformation* apiInformation = CreateDeckLinkAPIInformationInstance();
+	if (!apiInformation)
+		return std::nullopt;
+	int64_t version = 0;
+	auto res = apiInformation->GetInt(BMDDeckLinkAPIVersion, &version);
+	apiInformation->Release();
+	if (res != S_OK)
+		return std::nullopt;
+	return version;
+}
 #endif
 
+/// Held by worker threads that make SDK calls, COM has to be initialized on each of them on Windows.
+struct ComThreadScope
+{
+#if _WIN32
+	ComThreadScope() : Initialized(SUCCEEDED(CoInitializeEx(NULL, COINIT_MULTITHREADED))) {}
+	~ComThreadScope() { if (Initialized) CoUninitialize(); }
+	ComThreadScope(ComThreadScope const&) = delete;
+	ComThreadScope& operator=(ComThreadScope const&) = delete;
+	bool Initialized;
+#endif
+};
+
+inline std::optional<int64_t> GetDeckLinkIntAttribute(IDeckLink* deckLink, BMDDeckLinkAttributeID attribute)
+{
+	IDeckLinkProfileAttributes* attributes = nullptr;
+	if (deckLink->QueryInterface(IID_IDeckLinkProfileAttributes, (void**)&attributes) != S_OK || !attributes)
+		return std::nullopt;
+	int64_t value = 0;
+	auto res = attributes->GetInt(attribute, &value);
+	Release(attributes);
+	if (res != S_OK)
+		return std::nullopt;
+	return value;
+}
+
 
 template <typename T>
 class Object : public T
@@ -126,6 +196,77 @@ private:
 	std::atomic<int32_t> RefCount;
 };
 
+enum class HugePages : uint8_t
+{
+	None,
+	Transparent,
+	Explicit,
+};
+
+struct FrameMemoryPolicy
+{
+	int32_t NumaNode = -1; // -1: Not bound to a node
+	HugePages HugePageMode = HugePages::None;
+	bool LockInMemory = false;
+	bool SharedPool = false; // Buffers are leased from SharedFramePool
+
+	// Otherwise frames are allocated by the SDK.
+	bool UseFrameAllocator() const { return NumaNode >= 0 || HugePageMode != HugePages::None || LockInMemory || SharedPool; }
+};
+
+struct AudioFormat
+{
+	uint32_t ChannelCount = 0; // 0: Audio is disabled
+	BMDAudioSampleType SampleType = bmdAudioSampleType32bitInteger;
+
+	bool IsEnabled() const { return ChannelCount != 0; }
+	uint32_t GetBytesPerSampleFrame() const { return ChannelCount * (uint32_t(SampleType) / 8); }
+};
+
+/// Bytes held with their high watermark. Updated where memory is allocated and freed, from any thread.
+struct MemoryCounter
+{
+	std::atomic_uint64_t Bytes = 0;
+	std::atomic_uint64_t PeakBytes = 0;
+	std::shared_ptr<MemoryCounter> Parent; // Totals of the device. Set before the counter is used.
+
+	void Add(int64_t delta)
+	{
+		uint64_t bytes = Bytes.fetch_add(uint64_t(delta)) + uint64_t(delta);
+		uint64_t peak = PeakBytes;
+		while (bytes > peak && !PeakBytes.compare_exchange_weak(peak, bytes))
+			;
+		if (Parent)
+			Parent->Add(delta);
+	}
+	void ResetPeak() { PeakBytes = Bytes.load(); }
+	nosDeckLinkMemoryUsage Get() const { return {.Bytes = Bytes, .PeakBytes = PeakBytes}; }
+};
+
+/// Memory of a channel by purpose. Shared with the frame buffer pools of the channel, which can outlive it.
+struct ChannelMemoryCounters
+{
+	std::array<MemoryCounter, NOS_DECKLINK_MEMORY_PURPOSE_COUNT> Purposes;
+	MemoryCounter Total;
+
+	void Add(nosDeckLinkMemoryPurpose purpose, int64_t delta)
+	{
+		Purposes[purpose].Add(delta);
+		Total.Add(delta);
+	}
+	void Set(nosDeckLinkMemoryPurpose purpose, uint64_t bytes)
+	{
+		// Single writer per purpose, e.g. under the mutex guarding the memory.
+		Add(purpose, int64_t(bytes - Purposes[purpose].Bytes));
+	}
+	void ResetPeaks()
+	{
+		for (auto& counter : Purposes)
+			counter.ResetPeak();
+		Total.ResetPeak();
+	}
+};
+
 struct IOHandlerBaseI
 {
 	virtual ~IOHandlerBaseI() = default;
@@ -138,6 +279,19 @@ struct IOHandlerBaseI
 	
 	uint32_t FramesProcessed = 0;
 
+	FrameMemoryPolicy FrameMemory;
+	AudioFormat Audio;
+	bool CaptureAncillaryPackets = false; // Input only
+
+	// Statistics
+	std::atomic_uint64_t FramesCompleted = 0;
+	std::atomic_uint64_t FramesDropped = 0;
+	std::atomic_uint64_t FramesDisplayedLate = 0;
+	nosDeckLinkChannelStatistics GetStatistics() const;
+	void ResetStatistics();
+	// Peaks are kept across reopens, so memory that grows with every reopen shows up. Reset along with the statistics.
+	std::shared_ptr<ChannelMemoryCounters> Memory = std::make_shared<ChannelMemoryCounters>();
+
 	virtual bool Open(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat) = 0;
 	virtual bool Close() = 0;
 
@@ -147,25 +301,23 @@ struct IOHandlerBaseI
 	bool CloseStream();
 
 	virtual bool WaitFrame(std::chrono::milliseconds timeout) = 0;
-	virtual void DmaTransfer(void* buffer, size_t size) = 0;
+	virtual bool DmaTransfer(void* buffer, size_t size) = 0;
+	/// Page size and NUMA node of the frame buffers in use. 0 and -1 if frames are allocated by the SDK.
+	virtual std::pair<size_t, int32_t> GetFrameMemoryPlacement() = 0;
 	std::optional<nosVec2u> GetDeltaSeconds() const;
 	int32_t AddFrameResultCallback(nosDeckLinkFrameResultCallback callback, void* userData);
-	void RemoveFrameResultCallback(int32_t callbackId);
+	std::shared_ptr<ChannelCallbacks> GetCallbacks() const { return Callbacks; }
 
 protected:
 	virtual bool Start() = 0;
 	virtual bool Stop() = 0;
+	/// Statistics are counted by the caller, the result reported to callbacks does not always match what happened to the frame.
 	void OnFrameEnd(nosDeckLinkFrameResult result)
 	{
 		++FramesProcessed;
-		for (auto& [callbackId, pair] : FrameResultCallbacks)
-		{
-			auto& [callback, userData] = pair;
-			callback(userData, result, FramesProcessed);
-		}
+		CallbackDispatcher::Instance()->PostFrameResult(Callbacks, result, FramesProcessed);
 	}
-	std::unordered_map<int32_t, std::pair<nosDeckLinkFrameResultCallback, void*>> FrameResultCallbacks;
-	int32_t NextFrameResultCallbackId = 0;
+	std::shared_ptr<ChannelCallbacks> Callbacks = std::make_shared<ChannelCallbacks>();
 private:
 	std::atomic_bool IsOpen = false;
 	std::atomic_bool IsStreamRunning = false;
@@ -203,6 +355,7 @@ inline bool IOHandlerBaseI::OpenStream(BMDDisplayMode displayMode, BMDPixelForma
 		StopStream();
 	if (Open(displayMode, pixelFormat))
 	{
+		Callbacks->FrameIntervalNs = TimeScale ? FrameDuration * 1'000'000'000 / TimeScale : 0;
 		IsOpen = true;
 		return true;
 	}
@@ -259,14 +412,29 @@ inline std::optional<nosVec2u> IOHandlerBaseI::GetDeltaSeconds() const
 	return nosVec2u{ (uint32_t)FrameDuration, (uint32_t)TimeScale };
 }
 
-inline int32_t IOHandlerBaseI::AddFrameResultCallback(nosDeckLinkFrameResultCallback callback, void* userData)
+inline nosDeckLinkChannelStatistics IOHandlerBaseI::GetStatistics() const
 {
-	FrameResultCallbacks[NextFrameResultCallbackId] = { callback, userData };
-	return NextFrameResultCallbackId++;
+	return nosDeckLinkChannelStatistics{
+		.FramesCompleted = FramesCompleted,
+		.FramesDropped = FramesDropped,
+		.FramesDisplayedLate = FramesDisplayedLate,
+		.CallbackDeadlinesMissed = Callbacks->CallbackDeadlinesMissed,
+		.MaxCallbackLatencyUs = Callbacks->MaxCallbackLatencyNs / 1000,
+	};
 }
 
-inline void IOHandlerBaseI::RemoveFrameResultCallback(int32_t callbackId)
+inline void IOHandlerBaseI::ResetStatistics()
+{
+	FramesCompleted = 0;
+	FramesDropped = 0;
+	FramesDisplayedLate = 0;
+	Callbacks->CallbackDeadlinesMissed = 0;
+	Callbacks->MaxCallbackLatencyNs = 0;
+	Memory->ResetPeaks();
+}
+
+inline int32_t IOHandlerBaseI::AddFrameResultCallback(nosDeckLinkFrameResultCallback callback, void* userData)
 {
-	FrameResultCallbacks.erase(callbackId);
+	return Callbacks->FrameResult.Add(callback, userData);
 }
 }
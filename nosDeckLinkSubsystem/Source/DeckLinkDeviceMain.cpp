@@ -18,6 +18,8 @@ NOS_END_IMPORT_DEPS()
 #include "Device.hpp"
 #include "SubDevice.hpp"
 #include "DeviceManager.hpp"
+#include "CallbackDispatcher.hpp"
+#include "FrameAllocator.hpp"
 
 namespace nos::decklink
 {
@@ -26,6 +28,8 @@ std::unordered_map<uint32_t, nosDeckLinkSubsystem*> GExportedSubsystemVersions;
 nosResult NOSAPI_CALL UnloadSubsystem()
 {
 	DeviceManager::Destroy();
+	CallbackDispatcher::Destroy();
+	SharedFramePool::Destroy();
 	return NOS_RESULT_SUCCESS;
 }
 
@@ -60,10 +64,14 @@ void NOSAPI_CALL GetDevices(size_t* outCount, nosDeckLinkDeviceDesc* outDeviceDe
 {
 	if (outCount == nullptr)
 		return;
-	auto& devices = DeviceManager::Instance()->GetDevices();
-	*outCount = devices.size();
+	auto devices = DeviceManager::Instance()->GetDevices();
 	if (outDeviceDescriptors == nullptr)
+	{
+		*outCount = devices.size();
 		return;
+	}
+	// Devices can be attached between the two calls, never write past what the caller allocated.
+	*outCount = std::min(*outCount, devices.size());
 	for (size_t i = 0; i < *outCount; i++)
 	{
 		DeviceLock lock(i);
@@ -99,7 +107,7 @@ nosResult NOSAPI_CALL GetAvailableChannels(uint32_t deviceIndex, nosMediaIODirec
 
 nosDeckLinkChannel NOSAPI_CALL GetChannelFromName(const char* channelName)
 {
-	for (int i = 0; i < NOS_DECKLINK_CHANNEL_COUNT; i++)
+	for (int i = NOS_DECKLINK_CHANNEL_MIN; i <= NOS_DECKLINK_CHANNEL_MAX; i++)
 	{
 		if (strcmp(NOS_DECKLINK_CHANNEL_NAMES[i], channelName) == 0)
 			return nosDeckLinkChannel(i);
@@ -109,7 +117,7 @@ nosDeckLinkChannel NOSAPI_CALL GetChannelFromName(const char* channelName)
 
 nosResult NOSAPI_CALL GetDeviceByUniqueDisplayName(const char* uniqueDisplayName, uint32_t* outDeviceIndex)
 {
-	auto& devices = DeviceManager::Instance()->GetDevices();
+	auto devices = DeviceManager::Instance()->GetDevices();
 	for (size_t i = 0; i < devices.size(); i++)
 	{
 		auto& device = devices[i];
@@ -125,7 +133,7 @@ nosResult NOSAPI_CALL GetDeviceByUniqueDisplayName(const char* uniqueDisplayName
 nosResult NOSAPI_CALL GetDeviceInfoByIndex(uint32_t deviceIndex, nosDeckLinkDeviceInfo* outInfo)
 {
 	DeviceLock lock(deviceIndex);
-	auto& devices = DeviceManager::Instance()->GetDevices();
+	auto devices = DeviceManager::Instance()->GetDevices();
 	if (deviceIndex >= devices.size())
 	{
 		nosEngine.LogE("No such device with index %d", deviceIndex);
@@ -137,6 +145,7 @@ nosResult NOSAPI_CALL GetDeviceInfoByIndex(uint32_t deviceIndex, nosDeckLinkDevi
 	auto uniqueDisplayName = device->GetUniqueDisplayName();
 	size_t maxSize = sizeof(outInfo->Desc.UniqueDisplayName);
 	strncpy(outInfo->Desc.UniqueDisplayName, uniqueDisplayName.c_str(), std::min(uniqueDisplayName.size() + 1, maxSize));
+	outInfo->Placement = device->GetPlacement();
 	return NOS_RESULT_SUCCESS;
 }
 
@@ -152,7 +161,7 @@ nosResult NOSAPI_CALL GetSupportedOutputFrameGeometries(uint32_t deviceIndex, no
 	auto* subDevice = internal::GetSubDevice(deviceIndex, NOS_MEDIAIO_DIRECTION_OUTPUT, channel);
 	if (!subDevice)
 		return NOS_RESULT_NOT_FOUND;
-	auto supported = subDevice->GetSupportedOutputFrameGeometryAndFrameRates({NOS_MEDIAIO_PIXEL_FORMAT_YCBCR_8BIT, NOS_MEDIAIO_PIXEL_FORMAT_YCBCR_10BIT});
+	auto supported = subDevice->GetSupportedOutputFrameGeometryAndFrameRates({NOS_MEDIAIO_PIXEL_FORMAT_YCBCR_8BIT, NOS_MEDIAIO_PIXEL_FORMAT_YCBCR_10BIT}, GetSupportedVideoModeFlagsOfChannel(channel));
 	outGeometries->Count = supported.size();
 	int i = 0;
 	for (auto& [fg, _] : supported)
@@ -171,7 +180,7 @@ nosResult NOSAPI_CALL GetSupportedOutputFrameRatesForGeometry(uint32_t deviceInd
 	auto* subDevice = internal::GetSubDevice(deviceIndex, NOS_MEDIAIO_DIRECTION_OUTPUT, channel);
 	if (!subDevice)
 		return NOS_RESULT_NOT_FOUND;
-	auto supported = subDevice->GetSupportedOutputFrameGeometryAndFrameRates({NOS_MEDIAIO_PIXEL_FORMAT_YCBCR_8BIT, NOS_MEDIAIO_PIXEL_FORMAT_YCBCR_10BIT});
+	auto supported = subDevice->GetSupportedOutputFrameGeometryAndFrameRates({NOS_MEDIAIO_PIXEL_FORMAT_YCBCR_8BIT, NOS_MEDIAIO_PIXEL_FORMAT_YCBCR_10BIT}, GetSupportedVideoModeFlagsOfChannel(channel));
 	std::set<nosMediaIOFrameRate> frameRates;
 	for (auto& [_, frs] : supported)
 		frameRates.insert(frs.begin(), frs.end());
@@ -193,7 +202,7 @@ nosResult NOSAPI_CALL GetSupportedOutputPixelFormats(uint32_t deviceIndex, nosDe
 	auto* subDevice = internal::GetSubDevice(deviceIndex, NOS_MEDIAIO_DIRECTION_OUTPUT, channel);
 	if (!subDevice)
 		return NOS_RESULT_NOT_FOUND;
-	auto supported = subDevice->GetSupportedOutputVideoFormats();
+	auto supported = subDevice->GetSupportedOutputVideoFormats(GetSupportedVideoModeFlagsOfChannel(channel));
 	auto& pixelFormats = supported[frameGeo][frameRate];
 	outList->Count = pixelFormats.size();
 	int i = 0;
@@ -204,16 +213,18 @@ nosResult NOSAPI_CALL GetSupportedOutputPixelFormats(uint32_t deviceIndex, nosDe
 
 nosResult NOSAPI_CALL OpenChannel(uint32_t deviceIndex, nosDeckLinkOpenChannelParams* params)
 {
-	DeviceLock lock(deviceIndex);
+	// Exclusive, the open channel map is read under the shared lock by transfers on other threads.
+	DeviceLock lock(deviceIndex, false);
 	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
 	if (!device)
 	{
 		nosEngine.LogE("No such device with index %d", deviceIndex);
 		return NOS_RESULT_NOT_FOUND;
 	}
+	AudioFormat audio{.ChannelCount = params->Audio.ChannelCount, .SampleType = GetDeckLinkAudioSampleType(params->Audio.SampleType)};
 	if (params->Direction == NOS_MEDIAIO_DIRECTION_OUTPUT)
 	{
-		if (!device->OpenOutput(params->Channel, GetDeckLinkDisplayMode(params->Output.Geometry, params->Output.FrameRate), GetDeckLinkPixelFormat(params->PixelFormat)))
+		if (!device->OpenOutput(params->Channel, GetDeckLinkDisplayMode(params->Output.Geometry, params->Output.FrameRate), GetDeckLinkPixelFormat(params->PixelFormat), audio, params->Output.TimecodeMode, params->Output.TimecodeFormat, params->Output.KeyerMode, params->Output.KeyerSourceFormat))
 		{
 			nosEngine.LogE("Failed to open output for channel %s", GetChannelName(params->Channel));
 			return NOS_RESULT_FAILED;
@@ -221,7 +232,7 @@ nosResult NOSAPI_CALL OpenChannel(uint32_t deviceIndex, nosDeckLinkOpenChannelPa
 	}
 	else
 	{
-		if (!device->OpenInput(params->Channel, GetDeckLinkPixelFormat(params->PixelFormat)))
+		if (!device->OpenInput(params->Channel, GetDeckLinkPixelFormat(params->PixelFormat), audio, params->CaptureAncillaryPackets, params->DualStream3D))
 		{
 			nosEngine.LogE("Failed to open input for channel %s", GetChannelName(params->Channel));
 			return NOS_RESULT_FAILED;
@@ -232,7 +243,7 @@ nosResult NOSAPI_CALL OpenChannel(uint32_t deviceIndex, nosDeckLinkOpenChannelPa
 
 nosResult NOSAPI_CALL CloseChannel(uint32_t deviceIndex, nosDeckLinkChannel channel)
 {
-	DeviceLock lock(deviceIndex);
+	DeviceLock lock(deviceIndex, false);
 	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
 	if (!device)
 	{
@@ -247,6 +258,59 @@ nosResult NOSAPI_CALL CloseChannel(uint32_t deviceIndex, nosDeckLinkChannel chan
 	return NOS_RESULT_SUCCESS;
 }
 
+nosResult NOSAPI_CALL OpenChannelAsync(uint32_t deviceIndex, const nosDeckLinkOpenChannelParams* params, nosDeckLinkChannelOperationCallback callback, void* userData)
+{
+	if (!params)
+		return NOS_RESULT_INVALID_ARGUMENT;
+	auto queued = DeviceManager::Instance()->PushChannelOperation(deviceIndex, [deviceIndex, params = *params, callback, userData]() mutable {
+		if (callback)
+			callback(userData, params.Channel, NOS_DECKLINK_CHANNEL_OPERATION_STARTED, NOS_RESULT_SUCCESS);
+		auto result = OpenChannel(deviceIndex, &params);
+		if (callback)
+			callback(userData, params.Channel, NOS_DECKLINK_CHANNEL_OPERATION_FINISHED, result);
+	});
+	if (!queued)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	return NOS_RESULT_SUCCESS;
+}
+
+nosResult NOSAPI_CALL CloseChannelAsync(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkChannelOperationCallback callback, void* userData)
+{
+	auto queued = DeviceManager::Instance()->PushChannelOperation(deviceIndex, [deviceIndex, channel, callback, userData] {
+		if (callback)
+			callback(userData, channel, NOS_DECKLINK_CHANNEL_OPERATION_STARTED, NOS_RESULT_SUCCESS);
+		auto result = CloseChannel(deviceIndex, channel);
+		if (callback)
+			callback(userData, channel, NOS_DECKLINK_CHANNEL_OPERATION_FINISHED, result);
+	});
+	if (!queued)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	return NOS_RESULT_SUCCESS;
+}
+
+nosResult NOSAPI_CALL ReconfigureChannel(uint32_t deviceIndex, nosDeckLinkChannel channel, nosMediaIOFrameGeometry geometry, nosMediaIOFrameRate frameRate, nosMediaIOPixelFormat pixelFormat)
+{
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	if (!device->ReconfigureChannel(channel, GetDeckLinkDisplayMode(geometry, frameRate), GetDeckLinkPixelFormat(pixelFormat)))
+	{
+		nosEngine.LogE("Failed to reconfigure channel %s", GetChannelName(channel));
+		return NOS_RESULT_FAILED;
+	}
+	return NOS_RESULT_SUCCESS;
+}
+
 nosResult NOSAPI_CALL GetCurrentDeltaSecondsOfChannel(uint32_t deviceIndex, nosDeckLinkChannel channel, nosVec2u* outDeltaSeconds)
 {
 	DeviceLock lock(deviceIndex);
@@ -266,6 +330,137 @@ nosResult NOSAPI_CALL GetCurrentDeltaSecondsOfChannel(uint32_t deviceIndex, nosD
 	return NOS_RESULT_SUCCESS;
 }
 
+nosResult NOSAPI_CALL GetChannelFrameMemoryInfo(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkChannelFrameMemoryInfo* outInfo)
+{
+	if (!outInfo)
+		return NOS_RESULT_INVALID_ARGUMENT;
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	auto info = device->GetFrameMemoryInfoOfChannel(channel);
+	if (!info)
+		return NOS_RESULT_FAILED;
+	*outInfo = *info;
+	return NOS_RESULT_SUCCESS;
+}
+
+nosResult NOSAPI_CALL GetFramePoolUsage(nosDeckLinkFramePoolUsage* outUsage)
+{
+	if (!outUsage)
+		return NOS_RESULT_INVALID_ARGUMENT;
+	*outUsage = SharedFramePool::Instance()->GetUsage();
+	return NOS_RESULT_SUCCESS;
+}
+
+nosResult NOSAPI_CALL GetChannelStatistics(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkChannelStatistics* outStatistics)
+{
+	if (!outStatistics)
+		return NOS_RESULT_INVALID_ARGUMENT;
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	auto statistics = device->GetStatisticsOfChannel(channel);
+	if (!statistics)
+		return NOS_RESULT_FAILED;
+	*outStatistics = *statistics;
+	return NOS_RESULT_SUCCESS;
+}
+
+nosResult NOSAPI_CALL ResetChannelStatistics(uint32_t deviceIndex, nosDeckLinkChannel channel)
+{
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	return device->ResetStatisticsOfChannel(channel) ? NOS_RESULT_SUCCESS : NOS_RESULT_FAILED;
+}
+
+nosResult NOSAPI_CALL GetMemoryUsage(uint32_t deviceIndex, nosDeckLinkDeviceMemoryUsage* outUsage)
+{
+	if (!outUsage)
+		return NOS_RESULT_INVALID_ARGUMENT;
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	*outUsage = device->GetMemoryUsage();
+	return NOS_RESULT_SUCCESS;
+}
+
+nosResult NOSAPI_CALL ReadAudio(uint32_t deviceIndex, nosDeckLinkChannel channel, void* data, size_t size, nosDeckLinkAudioPacketInfo* outInfo)
+{
+	if (!outInfo)
+		return NOS_RESULT_INVALID_ARGUMENT;
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	return device->ReadAudio(channel, data, size, *outInfo) ? NOS_RESULT_SUCCESS : NOS_RESULT_FAILED;
+}
+
+nosResult NOSAPI_CALL WriteAudio(uint32_t deviceIndex, nosDeckLinkChannel channel, const void* data, size_t size)
+{
+	if (!data && size)
+		return NOS_RESULT_INVALID_ARGUMENT;
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	return device->WriteAudio(channel, data, size) ? NOS_RESULT_SUCCESS : NOS_RESULT_FAILED;
+}
+
+nosResult NOSAPI_CALL GetAudioOutputStatus(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkAudioOutputStatus* outStatus)
+{
+	if (!outStatus)
+		return NOS_RESULT_INVALID_ARGUMENT;
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	auto status = device->GetAudioOutputStatus(channel);
+	if (!status)
+		return NOS_RESULT_FAILED;
+	*outStatus = *status;
+	return NOS_RESULT_SUCCESS;
+}
+
+nosResult NOSAPI_CALL ReadAncillaryPackets(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkAncillaryPacketList* outList)
+{
+	if (!outList)
+		return NOS_RESULT_INVALID_ARGUMENT;
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	return device->ReadAncillaryPackets(channel, *outList) ? NOS_RESULT_SUCCESS : NOS_RESULT_FAILED;
+}
+
 nosResult NOSAPI_CALL WaitFrame(uint32_t deviceIndex, nosDeckLinkChannel channel, uint32_t timeoutMs)
 {
 	DeviceLock lock(deviceIndex);
@@ -294,6 +489,34 @@ nosResult NOSAPI_CALL DMATransfer(uint32_t deviceIndex, nosDeckLinkChannel chann
 	return NOS_RESULT_SUCCESS;
 }
 
+nosResult NOSAPI_CALL DMATransferWithInfo(uint32_t deviceIndex, nosDeckLinkChannel channel, void* data, size_t size, nosDeckLinkFrameInfo* outInfo)
+{
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	if (!device->DmaTransfer(channel, data, size, outInfo))
+		return NOS_RESULT_FAILED;
+	return NOS_RESULT_SUCCESS;
+}
+
+nosResult NOSAPI_CALL SetOutputTimecode(uint32_t deviceIndex, nosDeckLinkChannel channel, const nosDeckLinkTimecode* timecode)
+{
+	if (!timecode)
+		return NOS_RESULT_INVALID_ARGUMENT;
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	return device->SetOutputTimecode(channel, *timecode) ? NOS_RESULT_SUCCESS : NOS_RESULT_FAILED;
+}
+
 int32_t NOSAPI_CALL RegisterInputVideoFormatChangeCallback(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkInputVideoFormatChangeCallback callback, void* userData)
 {
 	DeviceLock lock(deviceIndex);
@@ -313,6 +536,30 @@ int32_t NOSAPI_CALL RegisterInputVideoFormatChangeCallback(uint32_t deviceIndex,
 }
 
 nosResult NOSAPI_CALL UnregisterInputVideoFormatChangeCallback(uint32_t deviceIndex, nosDeckLinkChannel channel, int32_t callbackId)
+{
+	std::shared_ptr<ChannelCallbacks> callbacks;
+	{
+		DeviceLock lock(deviceIndex);
+		auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+		if (!device)
+		{
+			nosEngine.LogE("No such device with index %d", deviceIndex);
+			return NOS_RESULT_NOT_FOUND;
+		}
+		auto* subDevice = device->GetSubDeviceOfChannel(NOS_MEDIAIO_DIRECTION_INPUT, channel);
+		if (!subDevice)
+		{
+			nosEngine.LogE("No sub-device found for channel %s", GetChannelName(channel));
+			return NOS_RESULT_NOT_FOUND;
+		}
+		callbacks = subDevice->GetCallbacks(NOS_MEDIAIO_DIRECTION_INPUT);
+	}
+	// Removal waits for running callbacks to return, which may call into the subsystem, so the device lock is not held here.
+	callbacks->VideoFormatChange.Remove(callbackId);
+	return NOS_RESULT_SUCCESS;	
+}
+
+int32_t NOSAPI_CALL RegisterInputVideoFormatChangeCallbackV2(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkInputVideoFormatChangeCallbackV2 callback, void* userData)
 {
 	DeviceLock lock(deviceIndex);
 	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
@@ -325,10 +572,71 @@ nosResult NOSAPI_CALL UnregisterInputVideoFormatChangeCallback(uint32_t deviceIn
 	if (!subDevice)
 	{
 		nosEngine.LogE("No sub-device found for channel %s", GetChannelName(channel));
+		return -1;
+	}
+	return subDevice->AddInputVideoFormatChangeCallbackV2(callback, userData);
+}
+
+nosResult NOSAPI_CALL UnregisterInputVideoFormatChangeCallbackV2(uint32_t deviceIndex, nosDeckLinkChannel channel, int32_t callbackId)
+{
+	std::shared_ptr<ChannelCallbacks> callbacks;
+	{
+		DeviceLock lock(deviceIndex);
+		auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+		if (!device)
+		{
+			nosEngine.LogE("No such device with index %d", deviceIndex);
+			return NOS_RESULT_NOT_FOUND;
+		}
+		auto* subDevice = device->GetSubDeviceOfChannel(NOS_MEDIAIO_DIRECTION_INPUT, channel);
+		if (!subDevice)
+		{
+			nosEngine.LogE("No sub-device found for channel %s", GetChannelName(channel));
+			return NOS_RESULT_NOT_FOUND;
+		}
+		callbacks = subDevice->GetCallbacks(NOS_MEDIAIO_DIRECTION_INPUT);
+	}
+	// Removal waits for running callbacks to return, which may call into the subsystem, so the device lock is not held here.
+	callbacks->VideoFormatChangeV2.Remove(callbackId);
+	return NOS_RESULT_SUCCESS;
+}
+
+nosResult NOSAPI_CALL SetOutputHDRMetadata(uint32_t deviceIndex, nosDeckLinkChannel channel, const nosDeckLinkHDRMetadata* metadata)
+{
+	if (!metadata)
+		return NOS_RESULT_INVALID_ARGUMENT;
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
 		return NOS_RESULT_NOT_FOUND;
 	}
-	subDevice->RemoveInputVideoFormatChangeCallback(callbackId);
-	return NOS_RESULT_SUCCESS;	
+	return device->SetOutputHDRMetadata(channel, *metadata) ? NOS_RESULT_SUCCESS : NOS_RESULT_FAILED;
+}
+
+nosResult NOSAPI_CALL SetOutputKeyerLevel(uint32_t deviceIndex, nosDeckLinkChannel channel, uint8_t level)
+{
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	return device->SetOutputKeyerLevel(channel, level) ? NOS_RESULT_SUCCESS : NOS_RESULT_FAILED;
+}
+
+nosResult NOSAPI_CALL RampOutputKeyer(uint32_t deviceIndex, nosDeckLinkChannel channel, bool up, uint32_t frameCount)
+{
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
+	{
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
+	}
+	return device->RampOutputKeyer(channel, up, frameCount) ? NOS_RESULT_SUCCESS : NOS_RESULT_FAILED;
 }
 
 nosResult NOSAPI_CALL StartStream(uint32_t deviceIndex, nosDeckLinkChannel channel)
@@ -355,7 +663,7 @@ nosResult NOSAPI_CALL StopStream(uint32_t deviceIndex, nosDeckLinkChannel channe
 	return device->StopStream(channel) ? NOS_RESULT_SUCCESS : NOS_RESULT_FAILED;
 }
 
-int32_t NOSAPI_CALL RegisterFrameResultCallback(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkFrameResultCallback callback, void* userData)
+nosResult NOSAPI_CALL PrerollStream(uint32_t deviceIndex, nosDeckLinkChannel channel)
 {
 	DeviceLock lock(deviceIndex);
 	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
@@ -364,16 +672,22 @@ int32_t NOSAPI_CALL RegisterFrameResultCallback(uint32_t deviceIndex, nosDeckLin
 		nosEngine.LogE("No such device with index %d", deviceIndex);
 		return NOS_RESULT_NOT_FOUND;
 	}
-	auto [subDevice, dir] = device->GetSubDeviceOfOpenChannel(channel);
-	if (!subDevice)
+	return device->PrerollStream(channel) ? NOS_RESULT_SUCCESS : NOS_RESULT_FAILED;
+}
+
+nosResult NOSAPI_CALL ActivateStream(uint32_t deviceIndex, nosDeckLinkChannel channel)
+{
+	DeviceLock lock(deviceIndex);
+	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+	if (!device)
 	{
-		nosEngine.LogE("No sub-device found open channel %s", GetChannelName(channel));
-		return -1;
+		nosEngine.LogE("No such device with index %d", deviceIndex);
+		return NOS_RESULT_NOT_FOUND;
 	}
-	return subDevice->AddFrameResultCallback(dir, callback, userData);
+	return device->ActivateStream(channel) ? NOS_RESULT_SUCCESS : NOS_RESULT_FAILED;
 }
 
-nosResult NOSAPI_CALL UnregisterFrameResultCallback(uint32_t deviceIndex, nosDeckLinkChannel channel, int32_t callbackId)
+int32_t NOSAPI_CALL RegisterFrameResultCallback(uint32_t deviceIndex, nosDeckLinkChannel channel, nosDeckLinkFrameResultCallback callback, void* userData)
 {
 	DeviceLock lock(deviceIndex);
 	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
@@ -386,9 +700,31 @@ nosResult NOSAPI_CALL UnregisterFrameResultCallback(uint32_t deviceIndex, nosDec
 	if (!subDevice)
 	{
 		nosEngine.LogE("No sub-device found open channel %s", GetChannelName(channel));
-		return NOS_RESULT_NOT_FOUND;
+		return -1;
+	}
+	return subDevice->AddFrameResultCallback(dir, callback, userData);
+}
+
+nosResult NOSAPI_CALL UnregisterFrameResultCallback(uint32_t deviceIndex, nosDeckLinkChannel channel, int32_t callbackId)
+{
+	std::shared_ptr<ChannelCallbacks> callbacks;
+	{
+		DeviceLock lock(deviceIndex);
+		auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+		if (!device)
+		{
+			nosEngine.LogE("No such device with index %d", deviceIndex);
+			return NOS_RESULT_NOT_FOUND;
+		}
+		auto [subDevice, dir] = device->GetSubDeviceOfOpenChannel(channel);
+		if (!subDevice)
+		{
+			nosEngine.LogE("No sub-device found open channel %s", GetChannelName(channel));
+			return NOS_RESULT_NOT_FOUND;
+		}
+		callbacks = subDevice->GetCallbacks(dir);
 	}
-	subDevice->RemoveFrameResultCallback(dir, callbackId);
+	callbacks->FrameResult.Remove(callbackId);
 	return NOS_RESULT_SUCCESS;	
 }
 
@@ -406,14 +742,18 @@ int32_t NOSAPI_CALL RegisterDeviceInvalidatedCallback(uint32_t deviceIndex, nosD
 
 nosResult NOSAPI_CALL UnregisterDeviceInvalidatedCallback(uint32_t deviceIndex, int32_t callbackId)
 {
-	DeviceLock lock(deviceIndex);
-	auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
-	if (!device)
+	std::shared_ptr<CallbackList<nosDeckLinkDeviceInvalidatedCallback>> callbacks;
 	{
-		nosEngine.LogE("No such device with index %d", deviceIndex);
-		return NOS_RESULT_NOT_FOUND;
+		DeviceLock lock(deviceIndex);
+		auto* device = DeviceManager::Instance()->GetDevice(deviceIndex);
+		if (!device)
+		{
+			nosEngine.LogE("No such device with index %d", deviceIndex);
+			return NOS_RESULT_NOT_FOUND;
+		}
+		callbacks = device->DeviceInvalidatedCallbacks;
 	}
-	device->RemoveDeviceInvalidatedCallback(callbackId);
+	callbacks->Remove(callbackId);
 	return NOS_RESULT_SUCCESS;
 }
 
@@ -470,6 +810,27 @@ nosResult NOSAPI_CALL Export(uint32_t minorVersion, void** outSubsystemContext)
 	subsystem->UnregisterDeviceInvalidatedCallback = UnregisterDeviceInvalidatedCallback;
 	subsystem->GetPortMappedChannelName = GetPortMappedChannelName;
 	subsystem->GetChannelFromPortMappedName = GetChannelFromPortMappedName;
+	subsystem->GetChannelFrameMemoryInfo = GetChannelFrameMemoryInfo;
+	subsystem->GetChannelStatistics = GetChannelStatistics;
+	subsystem->ResetChannelStatistics = ResetChannelStatistics;
+	subsystem->ReadAudio = ReadAudio;
+	subsystem->WriteAudio = WriteAudio;
+	subsystem->GetAudioOutputStatus = GetAudioOutputStatus;
+	subsystem->ReadAncillaryPackets = ReadAncillaryPackets;
+	subsystem->DMATransferWithInfo = DMATransferWithInfo;
+	subsystem->SetOutputTimecode = SetOutputTimecode;
+	subsystem->RegisterInputVideoFormatChangeCallbackV2 = RegisterInputVideoFormatChangeCallbackV2;
+	subsystem->UnregisterInputVideoFormatChangeCallbackV2 = UnregisterInputVideoFormatChangeCallbackV2;
+	subsystem->SetOutputHDRMetadata = SetOutputHDRMetadata;
+	subsystem->SetOutputKeyerLevel = SetOutputKeyerLevel;
+	subsystem->RampOutputKeyer = RampOutputKeyer;
+	subsystem->OpenChannelAsync = OpenChannelAsync;
+	subsystem->CloseChannelAsync = CloseChannelAsync;
+	subsystem->ReconfigureChannel = ReconfigureChannel;
+	subsystem->PrerollStream = PrerollStream;
+	subsystem->ActivateStream = ActivateStream;
+	subsystem->GetFramePoolUsage = GetFramePoolUsage;
+	subsystem->GetMemoryUsage = GetMemoryUsage;
 	*outSubsystemContext = subsystem;
 	GExportedSubsystemVersions[minorVersion] = subsystem;
 	return NOS_RESULT_SUCCESS;
@@ -521,6 +882,9 @@ nosResult NOSAPI_CALL Initialize()
 	{
 		DeviceManager::Instance()->LoadDefaultSettings();
 	}
+	auto& frameMemory = *DeviceManager::Instance()->Settings.frame_memory;
+	SharedFramePool::Instance()->SetLimits(size_t(frameMemory.pool_memory_limit_mb) << 20, size_t(frameMemory.channel_memory_quota_mb) << 20);
+	CallbackDispatcher::Instance();
 	DeviceManager::Instance()->InitializeDeviceList();
 	return NOS_RESULT_SUCCESS;
 }
@@ -6,8 +6,10 @@
 #include <nosUtil/Stopwatch.hpp>
 
 #include "ChannelMapping.inl"
+#include "CallbackDispatcher.hpp"
 #include "DeviceManager.hpp"
 #include "EnumConversions.hpp"
+#include "Numa.hpp"
 #include "SubDevice.hpp"
 
 namespace nos::decklink
@@ -16,8 +18,8 @@ namespace nos::decklink
 class ProfileChangeCallback : public Object<IDeckLinkProfileCallback>
 {
 public:
-	ProfileChangeCallback(uint32_t deviceIndex, int64_t deviceGroupId) :
-		DeviceIndex(deviceIndex), DeviceGroupId(deviceGroupId)
+	ProfileChangeCallback(uint32_t deviceIndex) :
+		DeviceIndex(deviceIndex)
 	{
 	}
 
@@ -32,15 +34,14 @@ public:
 	{
 		DeviceLock lock(DeviceIndex, false);
 		if (auto device = DeviceManager::Instance()->GetDevice(DeviceIndex))
-			device->Reinit(DeviceGroupId);
+			device->Reinit();
 		return S_OK;
 	}
 
 	uint32_t DeviceIndex;
-	int64_t DeviceGroupId;
 };
 
-std::vector<std::unique_ptr<class Device>> CreateDevices(std::optional<uint32_t> optGroupId)
+std::vector<std::unique_ptr<SubDevice>> CreateSubDevices(std::optional<int64_t> optGroupId)
 {
 	IDeckLinkIterator* deckLinkIterator = nullptr;
 
@@ -62,28 +63,44 @@ std::vector<std::unique_ptr<class Device>> CreateDevices(std::optional<uint32_t>
 	}
 
 	IDeckLink* deckLink = NULL;
-	uint32_t   deviceNumber = 0;
 
 	// Obtain an IDeckLink instance for each device on the system
-	std::vector<std::unique_ptr<SubDevice>> subDevices;
+	std::vector<IDeckLink*> deckLinks;
 	while (deckLinkIterator->Next(&deckLink) == S_OK)
 	{
-		auto bmDevice = std::make_unique<SubDevice>(deckLink);
-		if (optGroupId && bmDevice->DeviceGroupId != *optGroupId)
+		// Sub-devices of other groups are skipped before any other query, their streams may be running.
+		if (optGroupId && GetDeckLinkIntAttribute(deckLink, BMDDeckLinkDeviceGroupID) != *optGroupId)
 		{
-			bmDevice.reset();
 			Release(deckLink);
 			continue;
 		}
-		subDevices.push_back(std::move(bmDevice));
-		deviceNumber++;
+		deckLinks.push_back(deckLink);
 	}
 
 	if (deckLinkIterator)
 		deckLinkIterator->Release();
 
+	// Each sub-device makes a number of synchronous SDK queries on construction, so they are created concurrently.
+	// Results are collected in iteration order, sub-device indices in the channel map depend on it.
+	std::vector<std::future<std::unique_ptr<SubDevice>>> pendingSubDevices;
+	for (auto* curDeckLink : deckLinks)
+	{
+		pendingSubDevices.push_back(std::async(std::launch::async, [curDeckLink] {
+			ComThreadScope com;
+			return std::make_unique<SubDevice>(curDeckLink);
+		}));
+	}
+	std::vector<std::unique_ptr<SubDevice>> subDevices;
+	for (auto& pending : pendingSubDevices)
+		subDevices.push_back(pending.get());
+
+	return subDevices;
+}
+
+std::vector<std::unique_ptr<class Device>> CreateDevices()
+{
 	std::unordered_map<int64_t, std::vector<std::unique_ptr<SubDevice>>> subDevicePerDevice;
-	for (auto& subDevice : subDevices)
+	for (auto& subDevice : CreateSubDevices(std::nullopt))
 		subDevicePerDevice[subDevice->DeviceGroupId].push_back(std::move(subDevice));
 
 	std::vector<std::unique_ptr<Device>> devices;
@@ -98,7 +115,7 @@ std::vector<std::unique_ptr<class Device>> CreateDevices(std::optional<uint32_t>
 }
 
 Device::Device(uint32_t index, std::vector<std::unique_ptr<SubDevice>>&& subDevices)
-	: Index(index), SubDevices(std::move(subDevices)), DeviceInvalidatedCallbacksMutex(new std::mutex)
+	: Index(index), SubDevices(std::move(subDevices))
 {
 	if (SubDevices.empty())
 		nosEngine.LogE("No sub-device provided for device index: %d", index);
@@ -107,9 +124,15 @@ Device::Device(uint32_t index, std::vector<std::unique_ptr<SubDevice>>&& subDevi
 		ModelName = SubDevices[0]->ModelName;
 		GroupId = SubDevices[0]->DeviceGroupId;
 	}
+	InitSubDevices();
+}
 
+void Device::InitSubDevices()
+{
 	for (auto& subDevice : SubDevices)
-		subDevice->TagDevice(Index);
+		subDevice->TagDevice(Index, Memory);
+	// Probing takes hundreds of SDK calls per sub-device, it should not hold up module load or profile changes.
+	StartCapabilityRefresh();
 	
 	// Determine which sub-devices are capable of opening the channel
 	auto& channelMap = GetChannelMap();
@@ -120,10 +143,13 @@ Device::Device(uint32_t index, std::vector<std::unique_ptr<SubDevice>>&& subDevi
 		return;
 	}
 	auto& mapping = modelIt->second;
+	// Sub-devices and the links they drive depend on the active profile, e.g. quad-link channels need a single sub-device profile.
+	// In full-duplex profiles a sub-device captures on one connector and plays out on another.
+	auto activeProfile = GetActiveProfile().value_or(bmdProfileFourSubDevicesHalfDuplex);
 	for (auto& [profile, rest2] : mapping)
 	{
-		if (profile != bmdProfileFourSubDevicesHalfDuplex)
-			continue; // TODO.
+		if (profile != activeProfile)
+			continue;
 		for (auto& [subDeviceIndex, rest3] : rest2)
 		{
 			for (auto& [curChannel, modes] : rest3)
@@ -131,43 +157,81 @@ Device::Device(uint32_t index, std::vector<std::unique_ptr<SubDevice>>&& subDevi
 				if (auto subDevice = GetSubDevice(subDeviceIndex))
 				{
 					for (auto mode : modes)
-					{
 						Channel2SubDevice[mode][curChannel] = subDevice;
-						subDevice->TagChannel(mode, curChannel);
-					}
 				}
 			}
 		}
 	}
 
-	auto onProfileChange = new ProfileChangeCallback(Index, GroupId);
+	auto onProfileChange = new ProfileChangeCallback(Index);
 	if (onProfileChange == nullptr)
 		nosEngine.LogE("Could not create profile change callback");
-	else
-		GetProfileManager()->SetCallback(onProfileChange);
+	else if (auto profileManager = GetProfileManager())
+		profileManager->SetCallback(onProfileChange);
 	Release(onProfileChange);
 }
 
-void Device::Reinit(uint32_t groupId)
+void Device::Detach()
 {
-	{
-		IDeckLink* dlDevice = nullptr;
-		if (auto mainSubDevice = GetSubDevice(0))
-			dlDevice = mainSubDevice->DLDevice;
-		ClearSubDevices();
-		Release(dlDevice);
-	}
-	auto devices = CreateDevices(groupId);
-	if (devices.empty())
+	IDeckLink* dlDevice = nullptr;
+	if (auto mainSubDevice = GetSubDevice(0))
+		dlDevice = mainSubDevice->DLDevice;
+	ClearSubDevices();
+	Release(dlDevice);
+}
+
+bool Device::IsAttached() const
+{
+	return !SubDevices.empty();
+}
+
+bool Device::HasSubDevice(int64_t persistentId) const
+{
+	for (auto& subDevice : SubDevices)
+		if (subDevice->PersistentId == persistentId)
+			return true;
+	return false;
+}
+
+bool Device::HasDeckLink(IDeckLink* deckLink) const
+{
+	for (auto& subDevice : SubDevices)
+		if (subDevice->DLDevice == deckLink)
+			return true;
+	return false;
+}
+
+std::vector<int64_t> Device::GetPersistentIds() const
+{
+	std::vector<int64_t> ids;
+	for (auto& subDevice : SubDevices)
+		ids.push_back(subDevice->PersistentId);
+	return ids;
+}
+
+void Device::Reinit()
+{
+	Detach();
+	// Only this device is re-queried and rebuilt in place, so its index and callbacks stay valid and other devices are left alone.
+	SubDevices = CreateSubDevices(GroupId);
+	if (SubDevices.empty())
 	{
 		nosEngine.LogE("DeckLinkDevice: Failed to reinitialize device with index: %d", Index);
 		return;
 	}
-	if (devices.size() > 1)
-	{
-		nosEngine.LogE("DeckLinkDevice: Reinitialized device with index: %d, but found more than one device with same group ID!", Index);
-	}
-	*this = std::move(*devices[0]);
+	InitSubDevices();
+}
+
+void Device::StartCapabilityRefresh()
+{
+	for (auto& subDevice : SubDevices)
+		subDevice->StartCapabilityProbe();
+}
+
+void Device::StopCapabilityRefresh()
+{
+	for (auto& subDevice : SubDevices)
+		subDevice->StopCapabilityProbe();
 }
 
 std::string Device::GetUniqueDisplayName() const
@@ -175,21 +239,36 @@ std::string Device::GetUniqueDisplayName() const
 	return ModelName + " - " + std::to_string(Index);
 }
 
+int32_t Device::GetNumaNode() const
+{
+	if (SubDevices.empty())
+		return -1;
+	return SubDevices[0]->NumaNode;
+}
+
+nosDeckLinkDevicePlacement Device::GetPlacement() const
+{
+	nosDeckLinkDevicePlacement placement{.NumaNode = GetNumaNode()};
+	if (!SubDevices.empty())
+	{
+		auto& pciAddress = SubDevices[0]->PciAddress;
+		strncpy(placement.PciAddress, pciAddress.c_str(), sizeof(placement.PciAddress) - 1);
+	}
+	if (placement.NumaNode < 0)
+		return placement;
+	auto& numaSettings = *DeviceManager::Instance()->Settings.numa;
+	placement.FrameMemoryOnNumaNode = numaSettings.allocate_on_device_node;
+	placement.CallbackThreadPinned = CallbackDispatcher::Instance()->GetNumaNode() == placement.NumaNode;
+	placement.PinDmaThreads = numaSettings.pin_dma_threads;
+	return placement;
+}
+
 std::vector<nosDeckLinkChannel> Device::GetAvailableChannels(nosMediaIODirection mode)
 {
 	std::vector<nosDeckLinkChannel> channels;
-	static std::array allChannels {
-		NOS_DECKLINK_CHANNEL_SINGLE_LINK_1,
-		NOS_DECKLINK_CHANNEL_SINGLE_LINK_2,
-		NOS_DECKLINK_CHANNEL_SINGLE_LINK_3,
-		NOS_DECKLINK_CHANNEL_SINGLE_LINK_4,
-		NOS_DECKLINK_CHANNEL_SINGLE_LINK_5,
-		NOS_DECKLINK_CHANNEL_SINGLE_LINK_6,
-		NOS_DECKLINK_CHANNEL_SINGLE_LINK_7,
-		NOS_DECKLINK_CHANNEL_SINGLE_LINK_8
-	};
-	for (auto& channel : allChannels)
+	for (int i = NOS_DECKLINK_CHANNEL_MIN + 1; i <= NOS_DECKLINK_CHANNEL_MAX; ++i)
 	{
+		auto channel = static_cast<nosDeckLinkChannel>(i);
 		if (CanOpenChannel(mode, channel))
 			channels.push_back(channel);
 	}
@@ -205,7 +284,7 @@ bool Device::CanOpenChannel(nosMediaIODirection dir, nosDeckLinkChannel channel,
 		if (cit != dit->second.end())
 		{
 			auto* subDevice = cit->second;
-			if (!subDevice->IsBusy())
+			if (!subDevice->IsBusyFor(dir))
 			{
 				if (outSubDevice)
 					*outSubDevice = subDevice;
@@ -324,7 +403,7 @@ void Device::UpdateProfile(BMDProfileID newProfileId)
 	Release(profileIter);
 }
 
-bool Device::OpenOutput(nosDeckLinkChannel channel, BMDDisplayMode displayMode, BMDPixelFormat pixelFormat)
+bool Device::OpenOutput(nosDeckLinkChannel channel, BMDDisplayMode displayMode, BMDPixelFormat pixelFormat, AudioFormat audio, nosDeckLinkOutputTimecodeMode timecodeMode, nosDeckLinkTimecodeFormat timecodeFormat, nosDeckLinkKeyerMode keyerMode, nosDeckLinkKeyerSourceFormat keyerSourceFormat)
 {
 	auto subDevice = GetSubDeviceOfChannel(NOS_MEDIAIO_DIRECTION_OUTPUT, channel);
 	if (!subDevice)
@@ -332,11 +411,56 @@ bool Device::OpenOutput(nosDeckLinkChannel channel, BMDDisplayMode displayMode,
 		nosEngine.LogE("No sub-device found for channel %s", GetChannelName(channel));
 		return false;
 	}
-	if (subDevice->OpenOutput(displayMode, pixelFormat))
+	if (subDevice->IsBusyFor(NOS_MEDIAIO_DIRECTION_OUTPUT))
+	{
+		nosEngine.LogE("Sub-device of channel %s is in use by another channel", GetChannelName(channel));
+		return false;
+	}
+	SubDevice* keySubDevice = nullptr;
+	if (keyerMode == NOS_DECKLINK_KEYER_MODE_FILL_KEY_PAIR)
+	{
+		// Key goes out on the next channel with the same number of links.
+		auto keyChannel = nosDeckLinkChannel(channel + 1);
+		if (channel == NOS_DECKLINK_CHANNEL_MAX || GetDeckLinkLinkConfiguration(keyChannel) != GetDeckLinkLinkConfiguration(channel) ||
+			IsSquareDivisionChannel(keyChannel) != IsSquareDivisionChannel(channel) || !CanOpenChannel(NOS_MEDIAIO_DIRECTION_OUTPUT, keyChannel, &keySubDevice))
+		{
+			nosEngine.LogE("Key channel of %s is not available", GetChannelName(channel));
+			return false;
+		}
+		// In profiles where a sub-device drives several channels, both can map to the same one, which can only output one of them.
+		if (keySubDevice == subDevice)
+		{
+			nosEngine.LogE("Key channel of %s is driven by the same sub-device as the fill", GetChannelName(channel));
+			return false;
+		}
+		auto previousKeyTag = keySubDevice->GetTaggedChannel(NOS_MEDIAIO_DIRECTION_OUTPUT);
+		keySubDevice->TagChannel(NOS_MEDIAIO_DIRECTION_OUTPUT, keyChannel);
+		if (!keySubDevice->SetOutputLinkConfiguration(keyChannel))
+		{
+			keySubDevice->TagChannel(NOS_MEDIAIO_DIRECTION_OUTPUT, previousKeyTag);
+			return false;
+		}
+		if (!keySubDevice->OpenOutput(displayMode, bmdFormat8BitBGRA, {}, NOS_DECKLINK_OUTPUT_TIMECODE_MODE_NONE, NOS_DECKLINK_TIMECODE_FORMAT_RP188_LTC, NOS_DECKLINK_KEYER_MODE_NONE, NOS_DECKLINK_KEYER_SOURCE_FORMAT_BGRA))
+		{
+			nosEngine.LogE("Failed to open key channel %s", GetChannelName(keyChannel));
+			keySubDevice->TagChannel(NOS_MEDIAIO_DIRECTION_OUTPUT, previousKeyTag);
+			return false;
+		}
+	}
+	// A sub-device can drive several channels (single, dual and quad link), tag it with the one being opened.
+	subDevice->TagChannel(NOS_MEDIAIO_DIRECTION_OUTPUT, channel);
+	if (subDevice->SetOutputLinkConfiguration(channel) && subDevice->OpenOutput(displayMode, pixelFormat, audio, timecodeMode, timecodeFormat, keyerMode, keyerSourceFormat))
 	{
 		OpenChannels[channel] = { subDevice, NOS_MEDIAIO_DIRECTION_OUTPUT };
+		if (keySubDevice)
+		{
+			subDevice->SetKeyOutput(keySubDevice);
+			KeySubDevices[channel] = keySubDevice;
+		}
 		return true;
 	}
+	if (keySubDevice)
+		keySubDevice->CloseOutput();
 	return false;
 }
 
@@ -356,13 +480,55 @@ bool Device::CloseChannel(nosDeckLinkChannel channel)
 	}
 	else
 	{
+		auto keyIt = KeySubDevices.find(channel);
+		if (keyIt != KeySubDevices.end())
+			subDevice->SetKeyOutput(nullptr);
 		if (!subDevice->CloseOutput())
 			return false;
+		if (keyIt != KeySubDevices.end())
+		{
+			keyIt->second->CloseOutput();
+			KeySubDevices.erase(keyIt);
+		}
 	}
 	OpenChannels.erase(it);
 	return true;
 }
 
+bool Device::ReconfigureChannel(nosDeckLinkChannel channel, BMDDisplayMode displayMode, BMDPixelFormat pixelFormat)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return false;
+	}
+	auto [subDevice, mode] = it->second;
+	if (mode != NOS_MEDIAIO_DIRECTION_OUTPUT)
+	{
+		nosEngine.LogE("Channel %s is not an output, inputs follow the incoming signal", GetChannelName(channel));
+		return false;
+	}
+	bool wasRunning = subDevice->GetIO(mode).IsCurrentlyRunning();
+	if (wasRunning && !StopStream(channel))
+		return false;
+	// Fill first, the key follows only if the fill made it. A failed reconfigure restores the previous format of that side,
+	// so the fill is switched back if its key fails, and both sides of the pair always play out the same display mode.
+	auto [previousDisplayMode, previousPixelFormat] = subDevice->GetOutputFormat();
+	bool reconfigured = subDevice->ReconfigureOutput(displayMode, pixelFormat);
+	auto keyIt = KeySubDevices.find(channel);
+	if (reconfigured && keyIt != KeySubDevices.end() && !keyIt->second->ReconfigureOutput(displayMode, bmdFormat8BitBGRA))
+	{
+		reconfigured = false;
+		if (!subDevice->ReconfigureOutput(previousDisplayMode, previousPixelFormat))
+			nosEngine.LogE("Failed to restore the previous format of channel %s after its key failed to reconfigure, channel should be reopened", GetChannelName(channel));
+	}
+	// Streams are started again in the format they end up with, also if reconfiguring failed and the previous one is restored.
+	if (wasRunning && !StartStream(channel))
+		return false;
+	return reconfigured;
+}
+
 std::optional<nosVec2u> Device::GetCurrentDeltaSecondsOfChannel(nosDeckLinkChannel channel)
 {
 	auto it = OpenChannels.find(channel);
@@ -375,6 +541,63 @@ std::optional<nosVec2u> Device::GetCurrentDeltaSecondsOfChannel(nosDeckLinkChann
 	return subDevice->GetDeltaSeconds(mode);
 }
 
+std::optional<nosDeckLinkChannelFrameMemoryInfo> Device::GetFrameMemoryInfoOfChannel(nosDeckLinkChannel channel)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return std::nullopt;
+	}
+	auto [subDevice, mode] = it->second;
+	auto [pageSize, numaNode] = subDevice->GetFrameMemoryPlacement(mode);
+	return nosDeckLinkChannelFrameMemoryInfo{.PageSize = pageSize, .NumaNode = numaNode};
+}
+
+std::optional<nosDeckLinkChannelStatistics> Device::GetStatisticsOfChannel(nosDeckLinkChannel channel)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return std::nullopt;
+	}
+	auto [subDevice, mode] = it->second;
+	return subDevice->GetIO(mode).GetStatistics();
+}
+
+bool Device::ResetStatisticsOfChannel(nosDeckLinkChannel channel)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return false;
+	}
+	auto [subDevice, mode] = it->second;
+	subDevice->GetIO(mode).ResetStatistics();
+	return true;
+}
+
+nosDeckLinkDeviceMemoryUsage Device::GetMemoryUsage()
+{
+	nosDeckLinkDeviceMemoryUsage usage{.Total = Memory->Get()};
+	for (auto& subDevice : SubDevices)
+	{
+		for (auto dir : {NOS_MEDIAIO_DIRECTION_INPUT, NOS_MEDIAIO_DIRECTION_OUTPUT})
+		{
+			auto& io = subDevice->GetIO(dir);
+			if (!io.Memory->Total.PeakBytes || usage.ChannelCount == std::size(usage.Channels))
+				continue;
+			auto& channelUsage = usage.Channels[usage.ChannelCount++];
+			channelUsage = {.Channel = io.Channel, .Direction = dir, .Total = io.Memory->Total.Get()};
+			for (size_t i = 0; i < NOS_DECKLINK_MEMORY_PURPOSE_COUNT; ++i)
+				channelUsage.Purposes[i] = io.Memory->Purposes[i].Get();
+		}
+	}
+	return usage;
+}
+
 bool Device::WaitFrame(nosDeckLinkChannel channel, std::chrono::milliseconds timeout)
 {
 	auto it = OpenChannels.find(channel);
@@ -387,7 +610,83 @@ bool Device::WaitFrame(nosDeckLinkChannel channel, std::chrono::milliseconds tim
 	return subDevice->WaitFrame(mode, timeout);
 }
 
-bool Device::DmaTransfer(nosDeckLinkChannel channel, void* buffer, size_t size)
+bool Device::DmaTransfer(nosDeckLinkChannel channel, void* buffer, size_t size, nosDeckLinkFrameInfo* outInfo)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return false;
+	}
+	auto [subDevice, mode] = it->second;
+	// The calling thread is not ours, it only runs on the node of the card while it copies.
+	std::optional<ScopedThreadNumaAffinity> pinned;
+	if (DeviceManager::Instance()->Settings.numa->pin_dma_threads && subDevice->NumaNode >= 0)
+		pinned.emplace(subDevice->NumaNode);
+	bool transferred = subDevice->DmaTransfer(mode, buffer, size);
+	if (outInfo)
+	{
+		*outInfo = {};
+		if (mode == NOS_MEDIAIO_DIRECTION_INPUT)
+			if (auto info = subDevice->GetLastReadFrameInfo())
+				*outInfo = *info;
+		outInfo->DmaThreadPinned = pinned && pinned->IsPinned();
+	}
+	return transferred;
+}
+
+bool Device::ReadAudio(nosDeckLinkChannel channel, void* buffer, size_t size, nosDeckLinkAudioPacketInfo& outInfo)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return false;
+	}
+	auto [subDevice, mode] = it->second;
+	if (mode != NOS_MEDIAIO_DIRECTION_INPUT)
+	{
+		nosEngine.LogE("Channel %s is not an input channel", GetChannelName(channel));
+		return false;
+	}
+	return subDevice->ReadAudio(buffer, size, outInfo);
+}
+
+bool Device::WriteAudio(nosDeckLinkChannel channel, const void* buffer, size_t size)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return false;
+	}
+	auto [subDevice, mode] = it->second;
+	if (mode != NOS_MEDIAIO_DIRECTION_OUTPUT)
+	{
+		nosEngine.LogE("Channel %s is not an output channel", GetChannelName(channel));
+		return false;
+	}
+	return subDevice->WriteAudio(buffer, size);
+}
+
+bool Device::SetOutputTimecode(nosDeckLinkChannel channel, nosDeckLinkTimecode const& timecode)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return false;
+	}
+	auto [subDevice, mode] = it->second;
+	if (mode != NOS_MEDIAIO_DIRECTION_OUTPUT)
+	{
+		nosEngine.LogE("Channel %s is not an output channel", GetChannelName(channel));
+		return false;
+	}
+	return subDevice->SetOutputTimecode(timecode);
+}
+
+bool Device::SetOutputHDRMetadata(nosDeckLinkChannel channel, nosDeckLinkHDRMetadata const& metadata)
 {
 	auto it = OpenChannels.find(channel);
 	if (it == OpenChannels.end())
@@ -396,11 +695,87 @@ bool Device::DmaTransfer(nosDeckLinkChannel channel, void* buffer, size_t size)
 		return false;
 	}
 	auto [subDevice, mode] = it->second;
-	subDevice->DmaTransfer(mode, buffer, size);
+	if (mode != NOS_MEDIAIO_DIRECTION_OUTPUT)
+	{
+		nosEngine.LogE("Channel %s is not an output channel", GetChannelName(channel));
+		return false;
+	}
+	subDevice->SetOutputHDRMetadata(metadata);
 	return true;
 }
 
-bool Device::OpenInput(nosDeckLinkChannel channel, BMDPixelFormat pixelFormat)
+bool Device::SetOutputKeyerLevel(nosDeckLinkChannel channel, uint8_t level)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return false;
+	}
+	auto [subDevice, mode] = it->second;
+	if (mode != NOS_MEDIAIO_DIRECTION_OUTPUT)
+	{
+		nosEngine.LogE("Channel %s is not an output channel", GetChannelName(channel));
+		return false;
+	}
+	return subDevice->SetOutputKeyerLevel(level);
+}
+
+bool Device::RampOutputKeyer(nosDeckLinkChannel channel, bool up, uint32_t frameCount)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return false;
+	}
+	auto [subDevice, mode] = it->second;
+	if (mode != NOS_MEDIAIO_DIRECTION_OUTPUT)
+	{
+		nosEngine.LogE("Channel %s is not an output channel", GetChannelName(channel));
+		return false;
+	}
+	return subDevice->RampOutputKeyer(up, frameCount);
+}
+
+std::optional<nosDeckLinkAudioOutputStatus> Device::GetAudioOutputStatus(nosDeckLinkChannel channel)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return std::nullopt;
+	}
+	auto [subDevice, mode] = it->second;
+	if (mode != NOS_MEDIAIO_DIRECTION_OUTPUT)
+	{
+		nosEngine.LogE("Channel %s is not an output channel", GetChannelName(channel));
+		return std::nullopt;
+	}
+	nosDeckLinkAudioOutputStatus status{};
+	if (!subDevice->GetAudioOutputStatus(status))
+		return std::nullopt;
+	return status;
+}
+
+bool Device::ReadAncillaryPackets(nosDeckLinkChannel channel, nosDeckLinkAncillaryPacketList& outList)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return false;
+	}
+	auto [subDevice, mode] = it->second;
+	if (mode != NOS_MEDIAIO_DIRECTION_INPUT)
+	{
+		nosEngine.LogE("Channel %s is not an input channel", GetChannelName(channel));
+		return false;
+	}
+	return subDevice->ReadAncillaryPackets(outList);
+}
+
+bool Device::OpenInput(nosDeckLinkChannel channel, BMDPixelFormat pixelFormat, AudioFormat audio, bool captureAncillaryPackets, bool dualStream3D)
 {
 	auto subDevice = GetSubDeviceOfChannel(NOS_MEDIAIO_DIRECTION_INPUT, channel);
 	if (!subDevice)
@@ -408,7 +783,14 @@ bool Device::OpenInput(nosDeckLinkChannel channel, BMDPixelFormat pixelFormat)
 		nosEngine.LogE("No sub-device found for channel %s", GetChannelName(channel));
 		return false;
 	}
-	if (subDevice->OpenInput(pixelFormat))
+	if (subDevice->IsBusyFor(NOS_MEDIAIO_DIRECTION_INPUT))
+	{
+		nosEngine.LogE("Sub-device of channel %s is in use by another channel", GetChannelName(channel));
+		return false;
+	}
+	// The link configuration of inputs is detected by the device.
+	subDevice->TagChannel(NOS_MEDIAIO_DIRECTION_INPUT, channel);
+	if (subDevice->OpenInput(pixelFormat, audio, captureAncillaryPackets, dualStream3D))
 	{
 		OpenChannels[channel] = { subDevice, NOS_MEDIAIO_DIRECTION_INPUT };
 		return true;
@@ -425,9 +807,37 @@ bool Device::StartStream(nosDeckLinkChannel channel)
 		return false;
 	}
 	auto [subDevice, mode] = it->second;
+	if (auto keyIt = KeySubDevices.find(channel); keyIt != KeySubDevices.end())
+		return StartFillAndKey(channel, subDevice, keyIt->second);
 	return subDevice->StartStream(mode);
 }
 
+bool Device::StartFillAndKey(nosDeckLinkChannel channel, SubDevice* fill, SubDevice* key)
+{
+	if (fill->IsOutputRunning() && key->IsOutputRunning())
+		return true;
+	// Scheduled playback starts on the first frame boundary of the card reference after the call, the SDK takes no common start time.
+	// Both calls are made in the first half of a frame so they land on the same boundary. A skew that remains is reported.
+	auto position = fill->GetOutputReferenceClockPosition();
+	if (position && position->TimeInFrame * 2 > position->TicksPerFrame)
+	{
+		std::this_thread::sleep_for(std::chrono::nanoseconds((position->TicksPerFrame - position->TimeInFrame) * 1'000'000'000 / position->TimeScale));
+		position = fill->GetOutputReferenceClockPosition();
+	}
+	// Key starts first, so it is running by the time the fill schedules frames for it.
+	if (!key->StartStream(NOS_MEDIAIO_DIRECTION_OUTPUT))
+		return false;
+	if (!fill->StartStream(NOS_MEDIAIO_DIRECTION_OUTPUT))
+	{
+		key->StopStream(NOS_MEDIAIO_DIRECTION_OUTPUT);
+		return false;
+	}
+	auto started = fill->GetOutputReferenceClockPosition();
+	if (position && started && started->Frame != position->Frame)
+		nosEngine.LogW("Fill and key of %s may have started %lld frame(s) apart", GetChannelName(channel), (long long)(started->Frame - position->Frame));
+	return true;
+}
+
 bool Device::StopStream(nosDeckLinkChannel channel)
 {
 	auto it = OpenChannels.find(channel);
@@ -437,13 +847,63 @@ bool Device::StopStream(nosDeckLinkChannel channel)
 		return false;
 	}
 	auto [subDevice, mode] = it->second;
-	return subDevice->StopStream(mode);
+	bool stopped = subDevice->StopStream(mode);
+	if (auto keyIt = KeySubDevices.find(channel); keyIt != KeySubDevices.end())
+		stopped &= keyIt->second->StopStream(NOS_MEDIAIO_DIRECTION_OUTPUT);
+	return stopped;
+}
+
+bool Device::PrerollStream(nosDeckLinkChannel channel)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return false;
+	}
+	auto [subDevice, mode] = it->second;
+	if (mode != NOS_MEDIAIO_DIRECTION_OUTPUT)
+	{
+		nosEngine.LogE("Channel %s is not an output, only outputs can be prerolled", GetChannelName(channel));
+		return false;
+	}
+	auto keyIt = KeySubDevices.find(channel);
+	if (keyIt != KeySubDevices.end() && !keyIt->second->PrerollOutput())
+		return false;
+	if (subDevice->PrerollOutput())
+		return true;
+	// Key should not stay in standby on its own, its next start would play out the stale preroll.
+	if (keyIt != KeySubDevices.end())
+		keyIt->second->CancelOutputPreroll();
+	return false;
+}
+
+bool Device::ActivateStream(nosDeckLinkChannel channel)
+{
+	auto it = OpenChannels.find(channel);
+	if (it == OpenChannels.end())
+	{
+		nosEngine.LogE("No open channel found for channel %s", GetChannelName(channel));
+		return false;
+	}
+	auto [subDevice, mode] = it->second;
+	if (mode != NOS_MEDIAIO_DIRECTION_OUTPUT || !subDevice->IsOutputPrerolled())
+	{
+		nosEngine.LogE("Channel %s is not in standby, preroll it first", GetChannelName(channel));
+		return false;
+	}
+	return StartStream(channel);
 }
 
 void Device::ClearSubDevices()
 {
+	// Refresh works on the sub-devices without the device lock, it must be done before they are gone.
+	StopCapabilityRefresh();
+	if (SubDevices.empty())
+		return;
 	Channel2SubDevice.clear();
 	OpenChannels.clear();
+	KeySubDevices.clear();
 	std::vector<IDeckLink*> siblings;
 	auto* mainSubDevice = GetSubDevice(0);
 	for (auto& subDevice : SubDevices)
@@ -456,26 +916,11 @@ void Device::ClearSubDevices()
 	SubDevices.clear();
 	for (auto sibling : siblings)
 		Release(sibling);
-	{
-		std::unique_lock lock(*DeviceInvalidatedCallbacksMutex);
-		for (auto& [callbackId, pair] : DeviceInvalidatedCallbacks)
-		{
-			auto& [callback, userData] = pair;
-			callback(userData);
-		}
-	}
+	DeviceInvalidatedCallbacks->Invoke();
 }
 
 int32_t Device::AddDeviceInvalidatedCallback(nosDeckLinkDeviceInvalidatedCallback callback, void* userData)
 {
-	std::unique_lock lock(*DeviceInvalidatedCallbacksMutex);
-	DeviceInvalidatedCallbacks[NextDeviceInvalidatedCallbackId] = { callback, userData };
-	return NextDeviceInvalidatedCallbackId++;
-}
-
-void Device::RemoveDeviceInvalidatedCallback(int32_t callbackId)
-{
-	std::unique_lock lock(*DeviceInvalidatedCallbacksMutex);
-	DeviceInvalidatedCallbacks.erase(callbackId);
+	return DeviceInvalidatedCallbacks->Add(callback, userData);
 }
 }
@@ -5,6 +5,8 @@
 #include <string>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <future>
 
 #include "Common.hpp"
 #include "SubDevice.hpp"
@@ -20,16 +22,29 @@
 namespace nos::decklink
 {
 
-std::vector<std::unique_ptr<class Device>> CreateDevices(std::optional<uint32_t> optGroupId = std::nullopt);
+/// Sub-devices of every DeckLink, or only of the given device group.
+std::vector<std::unique_ptr<SubDevice>> CreateSubDevices(std::optional<int64_t> optGroupId);
+std::vector<std::unique_ptr<class Device>> CreateDevices();
 
 class Device
 {
 public:
+	/// Capabilities of the sub-devices are probed in the background, see SubDevice::StartCapabilityProbe.
 	Device(uint32_t index, std::vector<std::unique_ptr<SubDevice>>&& subDevices);
 
-	void Reinit(uint32_t groupId);
+	/// Recreates the sub-devices of this device after a profile change or after the device is attached again.
+	/// Capabilities are probed again in the background.
+	void Reinit();
+	/// Releases the sub-devices of a removed device. The device keeps its index and callbacks until it is attached again.
+	void Detach();
+	bool IsAttached() const;
+	bool HasSubDevice(int64_t persistentId) const;
+	bool HasDeckLink(IDeckLink* deckLink) const;
+	std::vector<int64_t> GetPersistentIds() const;
 
 	std::string GetUniqueDisplayName() const;
+	int32_t GetNumaNode() const;
+	nosDeckLinkDevicePlacement GetPlacement() const;
 
 	std::vector<nosDeckLinkChannel> GetAvailableChannels(nosMediaIODirection mode);
 
@@ -47,32 +62,54 @@ public:
 	SubDevice* GetSubDevice(int64_t index) const;
 
 	// Channels
-	bool OpenOutput(nosDeckLinkChannel channel, BMDDisplayMode displayMode, BMDPixelFormat pixelFormat);
-	bool OpenInput(nosDeckLinkChannel channel, BMDPixelFormat pixelFormat);
+	bool OpenOutput(nosDeckLinkChannel channel, BMDDisplayMode displayMode, BMDPixelFormat pixelFormat, AudioFormat audio, nosDeckLinkOutputTimecodeMode timecodeMode, nosDeckLinkTimecodeFormat timecodeFormat, nosDeckLinkKeyerMode keyerMode, nosDeckLinkKeyerSourceFormat keyerSourceFormat);
+	bool OpenInput(nosDeckLinkChannel channel, BMDPixelFormat pixelFormat, AudioFormat audio, bool captureAncillaryPackets, bool dualStream3D);
 	bool StartStream(nosDeckLinkChannel channel);
 	bool StopStream(nosDeckLinkChannel channel);
+	bool PrerollStream(nosDeckLinkChannel channel);
+	bool ActivateStream(nosDeckLinkChannel channel);
 	bool CloseChannel(nosDeckLinkChannel channel);
+	bool ReconfigureChannel(nosDeckLinkChannel channel, BMDDisplayMode displayMode, BMDPixelFormat pixelFormat);
 	std::optional<nosVec2u> GetCurrentDeltaSecondsOfChannel(nosDeckLinkChannel channel);
+	std::optional<nosDeckLinkChannelFrameMemoryInfo> GetFrameMemoryInfoOfChannel(nosDeckLinkChannel channel);
+	std::optional<nosDeckLinkChannelStatistics> GetStatisticsOfChannel(nosDeckLinkChannel channel);
+	bool ResetStatisticsOfChannel(nosDeckLinkChannel channel);
+	/// Channels of sub-devices recreated by Reinit start over, the device total is kept.
+	nosDeckLinkDeviceMemoryUsage GetMemoryUsage();
 
 	bool WaitFrame(nosDeckLinkChannel channel, std::chrono::milliseconds timeout);
-	bool DmaTransfer(nosDeckLinkChannel channel, void* buffer, size_t size);
+	bool DmaTransfer(nosDeckLinkChannel channel, void* buffer, size_t size, nosDeckLinkFrameInfo* outInfo = nullptr);
+	bool ReadAudio(nosDeckLinkChannel channel, void* buffer, size_t size, nosDeckLinkAudioPacketInfo& outInfo);
+	bool WriteAudio(nosDeckLinkChannel channel, const void* buffer, size_t size);
+	bool ReadAncillaryPackets(nosDeckLinkChannel channel, nosDeckLinkAncillaryPacketList& outList);
+	bool SetOutputTimecode(nosDeckLinkChannel channel, nosDeckLinkTimecode const& timecode);
+	bool SetOutputHDRMetadata(nosDeckLinkChannel channel, nosDeckLinkHDRMetadata const& metadata);
+	bool SetOutputKeyerLevel(nosDeckLinkChannel channel, uint8_t level);
+	bool RampOutputKeyer(nosDeckLinkChannel channel, bool up, uint32_t frameCount);
+	std::optional<nosDeckLinkAudioOutputStatus> GetAudioOutputStatus(nosDeckLinkChannel channel);
 
 	void ClearSubDevices();
 
 	int32_t AddDeviceInvalidatedCallback(nosDeckLinkDeviceInvalidatedCallback callback, void* userData);
-	void RemoveDeviceInvalidatedCallback(int32_t callbackId);
 
 	uint32_t Index = -1;
 	int64_t GroupId = -1;
 	std::string ModelName;
+	// Shared so that callbacks can be removed without holding the device lock.
+	std::shared_ptr<CallbackList<nosDeckLinkDeviceInvalidatedCallback>> DeviceInvalidatedCallbacks = std::make_shared<CallbackList<nosDeckLinkDeviceInvalidatedCallback>>();
+	// Parent of the memory counters of all channels. Shared with them, frame buffer pools can outlive the sub-devices.
+	std::shared_ptr<MemoryCounter> Memory = std::make_shared<MemoryCounter>();
 protected:
+	void InitSubDevices();
+	void StartCapabilityRefresh();
+	void StopCapabilityRefresh();
+	bool StartFillAndKey(nosDeckLinkChannel channel, SubDevice* fill, SubDevice* key);
+
 	std::vector<std::unique_ptr<SubDevice>> SubDevices;
 	std::unordered_map<nosMediaIODirection, std::unordered_map<nosDeckLinkChannel, SubDevice*>> Channel2SubDevice;
 	std::unordered_map<nosDeckLinkChannel, std::pair<SubDevice*, nosMediaIODirection>> OpenChannels;
-
-	int32_t NextDeviceInvalidatedCallbackId = 0;
-	std::unordered_map<int32_t, std::pair<nosDeckLinkDeviceInvalidatedCallback, void*>> DeviceInvalidatedCallbacks;
-	std::unique_ptr<std::mutex> DeviceInvalidatedCallbacksMutex;
+	// Key sub-devices of fill/key pairs, by fill channel. Not in OpenChannels, they follow their fill channel.
+	std::unordered_map<nosDeckLinkChannel, SubDevice*> KeySubDevices;
 };
 	
 }
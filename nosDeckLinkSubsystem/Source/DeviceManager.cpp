@@ -2,7 +2,9 @@
 #include "DeviceManager.hpp"
 
 #include "ChannelMapping.inl"
+#include "CallbackDispatcher.hpp"
 #include "Device.hpp"
+#include "Scheduling.hpp"
 
 namespace nos::decklink
 {
@@ -10,6 +12,21 @@ namespace nos::decklink
 const char* NOSAPI_CALL GetChannelName(nosDeckLinkChannel channel);
 nosDeckLinkChannel NOSAPI_CALL GetChannelFromName(const char* channelName);
 
+class DeviceNotificationCallback : public Object<IDeckLinkDeviceNotificationCallback>
+{
+public:
+	HRESULT STDMETHODCALLTYPE DeckLinkDeviceArrived(IDeckLink* deckLinkDevice) override
+	{
+		DeviceManager::Instance()->OnDeckLinkArrived(deckLinkDevice);
+		return S_OK;
+	}
+	HRESULT STDMETHODCALLTYPE DeckLinkDeviceRemoved(IDeckLink* deckLinkDevice) override
+	{
+		DeviceManager::Instance()->OnDeckLinkRemoved(deckLinkDevice);
+		return S_OK;
+	}
+};
+
 DeviceManager::DeviceManager()
 {
 }
@@ -22,11 +39,20 @@ DeviceManager::~DeviceManager()
 void DeviceManager::LoadDefaultSettings()
 {
 	Settings = {};
+	Settings.numa = std::make_unique<sys::decklink::TNumaSettings>();
+	Settings.frame_memory = std::make_unique<sys::decklink::TFrameMemorySettings>();
+	Settings.thread_scheduling = std::make_unique<sys::decklink::TThreadSchedulingSettings>();
 }
 
 void DeviceManager::LoadSettings(sys::decklink::Settings const& settings)
 {
 	settings.UnPackTo(&Settings);
+	if (!Settings.numa)
+		Settings.numa = std::make_unique<sys::decklink::TNumaSettings>();
+	if (!Settings.frame_memory)
+		Settings.frame_memory = std::make_unique<sys::decklink::TFrameMemorySettings>();
+	if (!Settings.thread_scheduling)
+		Settings.thread_scheduling = std::make_unique<sys::decklink::TThreadSchedulingSettings>();
 	if (!ValidatePortMappings())
 	{
 		nosEngine.LogE("DeviceManager: Invalid port mappings in settings. Loading default settings.");
@@ -97,9 +123,55 @@ bool DeviceManager::ValidatePortMappings()
 
 void DeviceManager::InitializeDeviceList()
 {
-	Devices = CreateDevices();
+	CapabilityCache.Load(std::filesystem::path(nosEngine.Module->RootFolderPath) / "Config/CapabilityCache.bin", GetDeckLinkAPIVersion());
+	{
+		std::unique_lock lock(DeviceListMutex);
+		Devices = CreateDevices();
+		for (auto& device : Devices)
+		{
+			DeviceMutexes[device->Index] = std::make_unique<std::shared_mutex>();
+			for (auto persistentId : device->GetPersistentIds())
+				DeviceIndexOfPersistentId[persistentId] = device->Index;
+		}
+	}
+	StartDeviceDiscovery();
+	if (Settings.numa->pin_callback_thread)
+		PinCallbackThread();
+	ApplyThreadScheduling(CallbackDispatcher::Instance()->GetThread(), "Callback");
+}
+
+void DeviceManager::ApplyThreadScheduling(std::thread& thread, const char* threadName)
+{
+	auto& scheduling = *Settings.thread_scheduling;
+	SchedulingPolicy policy = SchedulingPolicy::Default;
+	switch (scheduling.policy)
+	{
+	case sys::decklink::SchedulingPolicy::Fifo: policy = SchedulingPolicy::Fifo; break;
+	case sys::decklink::SchedulingPolicy::RoundRobin: policy = SchedulingPolicy::RoundRobin; break;
+	default: return;
+	}
+	std::string error;
+	if (SetThreadScheduling(thread, policy, scheduling.priority, error))
+		nosEngine.LogI("DeviceManager: %s thread uses %s scheduling with priority %d", threadName, sys::decklink::EnumNameSchedulingPolicy(scheduling.policy), scheduling.priority);
+	else
+		nosEngine.LogW("DeviceManager: Failed to set %s scheduling for %s thread (%s), it keeps default scheduling", sys::decklink::EnumNameSchedulingPolicy(scheduling.policy), threadName, error.c_str());
+}
+
+void DeviceManager::PinCallbackThread()
+{
+	std::set<int32_t> numaNodes;
 	for (auto& device : Devices)
-		DeviceMutexes[device->Index] = std::make_unique<std::shared_mutex>();
+		numaNodes.insert(device->GetNumaNode());
+	if (numaNodes.size() != 1 || *numaNodes.begin() < 0)
+	{
+		nosEngine.LogW("DeviceManager: Cards are not on a single known NUMA node, callback thread is not pinned.");
+		return;
+	}
+	auto numaNode = *numaNodes.begin();
+	if (CallbackDispatcher::Instance()->SetNumaAffinity(numaNode))
+		nosEngine.LogI("DeviceManager: Callback thread is pinned to NUMA node %d", numaNode);
+	else
+		nosEngine.LogW("DeviceManager: Failed to pin callback thread to NUMA node %d", numaNode);
 }
 
 std::string SimultaneousReplace(std::string_view input, const std::map<std::string, std::string>& transformations)
@@ -197,26 +269,156 @@ nosDeckLinkChannel DeviceManager::GetChannelFromPortMappedName(uint32_t deviceIn
 	return GetChannelFromName(originalName.c_str());
 }
 
+void DeviceManager::StartDeviceDiscovery()
+{
+	if (GetDeckLinkDiscovery(&Discovery) != S_OK || !Discovery)
+	{
+		nosEngine.LogW("DeviceManager: Device discovery is not available, devices attached later will not show up until the module is reloaded");
+		Discovery = nullptr;
+		return;
+	}
+	DiscoveryCallback = new DeviceNotificationCallback;
+	// Already enumerated devices are reported once more here, they are recognized by their persistent IDs.
+	if (Discovery->InstallDeviceNotifications(DiscoveryCallback) != S_OK)
+	{
+		nosEngine.LogW("DeviceManager: Failed to install device notifications, devices attached later will not show up until the module is reloaded");
+		Release(DiscoveryCallback);
+		Release(Discovery);
+	}
+}
+
+void DeviceManager::StopDeviceDiscovery()
+{
+	if (!Discovery)
+		return;
+	Discovery->UninstallDeviceNotifications();
+	Release(DiscoveryCallback);
+	Release(Discovery);
+}
+
+std::optional<uint32_t> DeviceManager::FindDeviceIndex(int64_t persistentId, std::optional<int64_t> groupId)
+{
+	std::shared_lock lock(DeviceListMutex);
+	auto it = DeviceIndexOfPersistentId.find(persistentId);
+	if (it != DeviceIndexOfPersistentId.end())
+		return it->second;
+	if (groupId)
+	{
+		for (auto& device : Devices)
+			if (device->GroupId == *groupId)
+				return device->Index;
+	}
+	return std::nullopt;
+}
+
+void DeviceManager::IndexPersistentIds(Device& device)
+{
+	std::unique_lock lock(DeviceListMutex);
+	for (auto persistentId : device.GetPersistentIds())
+		DeviceIndexOfPersistentId[persistentId] = device.Index;
+}
+
+void DeviceManager::OnDeckLinkArrived(IDeckLink* deckLink)
+{
+	std::unique_lock hotPlugLock(HotPlugMutex);
+	auto persistentId = GetDeckLinkIntAttribute(deckLink, BMDDeckLinkPersistentID);
+	auto groupId = GetDeckLinkIntAttribute(deckLink, BMDDeckLinkDeviceGroupID);
+	if (!persistentId || !groupId)
+	{
+		nosEngine.LogW("DeviceManager: Ignoring attached DeckLink without persistent or group ID");
+		return;
+	}
+	if (auto index = FindDeviceIndex(*persistentId, groupId))
+	{
+		DeviceLock lock(*index, false);
+		auto* device = GetDevice(*index);
+		if (!device || device->HasSubDevice(*persistentId))
+			return;
+		// Either the card is back or its sub-devices changed, in both cases its group is enumerated again.
+		device->Reinit();
+		IndexPersistentIds(*device);
+		nosEngine.LogI("DeviceManager: %s is attached", device->GetUniqueDisplayName().c_str());
+		return;
+	}
+	auto subDevices = CreateSubDevices(*groupId);
+	if (subDevices.empty())
+		return;
+	std::unique_lock lock(DeviceListMutex);
+	uint32_t index = Devices.size();
+	DeviceMutexes[index] = std::make_unique<std::shared_mutex>();
+	auto& device = Devices.emplace_back(std::make_unique<Device>(index, std::move(subDevices)));
+	for (auto id : device->GetPersistentIds())
+		DeviceIndexOfPersistentId[id] = index;
+	nosEngine.LogI("DeviceManager: New device %s is attached", device->GetUniqueDisplayName().c_str());
+}
+
+void DeviceManager::OnDeckLinkRemoved(IDeckLink* deckLink)
+{
+	std::unique_lock hotPlugLock(HotPlugMutex);
+	std::optional<uint32_t> index;
+	if (auto persistentId = GetDeckLinkIntAttribute(deckLink, BMDDeckLinkPersistentID))
+		index = FindDeviceIndex(*persistentId, std::nullopt);
+	if (!index)
+	{
+		// The removed device may not answer queries anymore.
+		for (auto* device : GetDevices())
+		{
+			DeviceLock lock(device->Index);
+			if (device->HasDeckLink(deckLink))
+				index = device->Index;
+		}
+	}
+	if (!index)
+		return;
+	DeviceLock lock(*index, false);
+	auto* device = GetDevice(*index);
+	if (!device || !device->IsAttached())
+		return;
+	nosEngine.LogW("DeviceManager: %s is removed", device->GetUniqueDisplayName().c_str());
+	// Invokes the device invalidated callbacks.
+	device->Detach();
+}
+
+bool DeviceManager::PushChannelOperation(uint32_t deviceIndex, std::function<void()> task)
+{
+	if (!GetDevice(deviceIndex))
+		return false;
+	std::unique_lock lock(ChannelOperationMutex);
+	auto& queue = ChannelOperationQueues[deviceIndex];
+	if (!queue)
+		queue = std::make_unique<TaskQueue>();
+	queue->Push(std::move(task));
+	return true;
+}
+
 void DeviceManager::ClearDeviceList()
 {
+	StopDeviceDiscovery();
+	// Queued channel operations still run, mainly so that pending closes are not lost.
+	std::unordered_map<uint32_t, std::unique_ptr<TaskQueue>> channelOperationQueues;
+	{
+		std::unique_lock lock(ChannelOperationMutex);
+		channelOperationQueues = std::move(ChannelOperationQueues);
+	}
+	channelOperationQueues.clear();
 	for (auto it = Devices.begin(); it != Devices.end(); ++it)
 	{
 		auto device = it->get();
 		IDeckLink* dlDevice = nullptr;
 		if (auto mainSubDevice = device->GetSubDevice(0))
 			dlDevice = mainSubDevice->DLDevice;
-		auto index = it->get()->Index;
-		LockDevice(index, false);
+		auto* mutex = LockDevice(it->get()->Index, false);
 		it->reset();
 		if (dlDevice)
 			Release(dlDevice);
-		UnlockDevice(index, false);
+		UnlockDevice(mutex, false);
 	}
 	Devices.clear();
 }
 
 Device* DeviceManager::GetDevice(int64_t groupId)
 {
+	std::shared_lock lock(DeviceListMutex);
 	for (auto& device : Devices)
 	{
 		if (device->GroupId == groupId)
@@ -227,31 +429,54 @@ Device* DeviceManager::GetDevice(int64_t groupId)
 
 Device* DeviceManager::GetDevice(uint32_t deviceIndex)
 {
+	std::shared_lock lock(DeviceListMutex);
 	if (deviceIndex < Devices.size())
 		return Devices[deviceIndex].get();
 	return nullptr;
 }
 
-void DeviceManager::LockDevice(uint32_t deviceIndex, bool shared)
+std::vector<Device*> DeviceManager::GetDevices()
 {
-	auto it = DeviceMutexes.find(deviceIndex);
-	if (it == DeviceMutexes.end())
-		return;
+	std::shared_lock lock(DeviceListMutex);
+	std::vector<Device*> devices;
+	for (auto& device : Devices)
+		devices.push_back(device.get());
+	return devices;
+}
+
+static std::shared_mutex* FindDeviceMutex(std::unordered_map<uint32_t, std::unique_ptr<std::shared_mutex>>& mutexes, uint32_t deviceIndex)
+{
+	auto it = mutexes.find(deviceIndex);
+	if (it == mutexes.end())
+		return nullptr;
+	return it->second.get();
+}
+
+std::shared_mutex* DeviceManager::LockDevice(uint32_t deviceIndex, bool shared)
+{
+	std::shared_mutex* mutex = nullptr;
+	{
+		// Not held while waiting for the device, hot-plug handlers lock devices and then the list.
+		std::shared_lock lock(DeviceListMutex);
+		mutex = FindDeviceMutex(DeviceMutexes, deviceIndex);
+	}
+	if (!mutex)
+		return nullptr;
 	if (shared)
-		it->second->lock_shared();
+		mutex->lock_shared();
 	else
-		it->second->lock();
+		mutex->lock();
+	return mutex;
 }
 
-void DeviceManager::UnlockDevice(uint32_t deviceIndex, bool shared)
+void DeviceManager::UnlockDevice(std::shared_mutex* mutex, bool shared)
 {
-	auto it = DeviceMutexes.find(deviceIndex);
-	if (it == DeviceMutexes.end())
+	if (!mutex)
 		return;
 	if (shared)
-		it->second->unlock_shared();
+		mutex->unlock_shared();
 	else
-		it->second->unlock();
+		mutex->unlock();
 }
 
 DeviceManager* DeviceManager::Instance()
@@ -5,9 +5,16 @@
 #include <memory>
 #include <unordered_map>
 #include <shared_mutex>
+#include <thread>
+#include <mutex>
+#include <optional>
 #include <Nodos/Modules.h>
 
+#include <DeckLinkAPI.h>
+
 #include "DeckLink_generated.h"
+#include "CapabilityCache.hpp"
+#include "TaskQueue.hpp"
 #include "nosDeckLinkSubsystem/nosDeckLinkSubsystem.h"
 
 namespace nos::decklink
@@ -20,9 +27,11 @@ public:
 	void ClearDeviceList();
 	Device* GetDevice(int64_t groupId);
 	Device* GetDevice(uint32_t deviceIndex);
-	const std::vector<std::unique_ptr<Device>>& GetDevices() { return Devices; }
-	void LockDevice(uint32_t deviceIndex, bool shared = true);
-	void UnlockDevice(uint32_t deviceIndex, bool shared = true);
+	/// Devices are added at runtime, so callers get a snapshot. Device pointers stay valid until the subsystem is unloaded.
+	std::vector<Device*> GetDevices();
+	/// Returns the mutex that is locked, null if the device has none. Unlock that mutex, one created in between must not be unlocked.
+	std::shared_mutex* LockDevice(uint32_t deviceIndex, bool shared = true);
+	static void UnlockDevice(std::shared_mutex* mutex, bool shared = true);
 	static DeviceManager* Instance();
 	static void Destroy();
 	~DeviceManager();
@@ -30,12 +39,37 @@ public:
 	void LoadDefaultSettings();
 	void LoadSettings(sys::decklink::Settings const& settings);
 	bool ValidatePortMappings();
+	/// Probed capabilities from previous runs, in Config next to the settings file.
+	CapabilityCacheFile CapabilityCache;
 	void InitializeDeviceList();
+	void PinCallbackThread();
+	/// Applies thread_scheduling settings to a thread owned by the subsystem.
+	void ApplyThreadScheduling(std::thread& thread, const char* threadName);
 	std::optional<std::string> GetPortMappedChannelName(uint32_t deviceIndex, nosDeckLinkChannel channel);
 	nosDeckLinkChannel GetChannelFromPortMappedName(uint32_t deviceIndex, std::string_view portMappedName);
+	// Hot-plug. Sub-devices are matched to devices by PersistentId, so a card that comes back keeps its device index.
+	void OnDeckLinkArrived(IDeckLink* deckLink);
+	void OnDeckLinkRemoved(IDeckLink* deckLink);
+	/// Runs the task on the channel operation worker of the device. Tasks of a device run in the order they are pushed.
+	bool PushChannelOperation(uint32_t deviceIndex, std::function<void()> task);
 protected:
+	void StartDeviceDiscovery();
+	void StopDeviceDiscovery();
+	std::optional<uint32_t> FindDeviceIndex(int64_t persistentId, std::optional<int64_t> groupId);
+	void IndexPersistentIds(Device& device);
+
+	// Guards the device list, the mutexes and the persistent ID index. Devices and their mutexes are never removed.
+	std::shared_mutex DeviceListMutex;
 	std::unordered_map<uint32_t, std::unique_ptr<std::shared_mutex>> DeviceMutexes;
 	std::vector<std::unique_ptr<Device>> Devices;
+	std::unordered_map<int64_t, uint32_t> DeviceIndexOfPersistentId;
+	// Serializes arrival and removal handling.
+	std::mutex HotPlugMutex;
+	IDeckLinkDiscovery* Discovery = nullptr;
+	IDeckLinkDeviceNotificationCallback* DiscoveryCallback = nullptr;
+	// One worker per device, created on first use, so a slow open or close only holds up operations of the same device.
+	std::mutex ChannelOperationMutex;
+	std::unordered_map<uint32_t, std::unique_ptr<TaskQueue>> ChannelOperationQueues;
 private:
 	DeviceManager();
 	static DeviceManager* SingleInstance;
@@ -44,20 +78,20 @@ private:
 struct DeviceLock
 {
 	DeviceLock(uint32_t deviceIndex, bool shared = true)
-		: DeviceIndex(deviceIndex), SharedLock(shared)
+		: SharedLock(shared)
 	{
-		DeviceManager::Instance()->LockDevice(deviceIndex, SharedLock);
+		Mutex = DeviceManager::Instance()->LockDevice(deviceIndex, SharedLock);
 	}
 	~DeviceLock()
 	{
-		DeviceManager::Instance()->UnlockDevice(DeviceIndex, SharedLock);
+		DeviceManager::UnlockDevice(Mutex, SharedLock);
 	}
 
 	DeviceLock(const DeviceLock&) = delete;
 	DeviceLock& operator=(const DeviceLock&) = delete;
 	DeviceLock(DeviceLock&&) = delete;
 protected:
-	uint32_t DeviceIndex;
+	std::shared_mutex* Mutex;
 	bool SharedLock;
 };
 }
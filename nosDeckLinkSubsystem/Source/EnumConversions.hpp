@@ -298,6 +298,72 @@ constexpr nosMediaIOPixelFormat GetPixelFormatFromDeckLink(BMDPixelFormat fmt)
 	}
 	return NOS_MEDIAIO_PIXEL_FORMAT_INVALID;
 }
+
+constexpr nosDeckLinkColorspace GetColorspaceFromDeckLink(BMDColorspace colorspace)
+{
+	switch (colorspace)
+	{
+	case bmdColorspaceRec601:
+		return NOS_DECKLINK_COLORSPACE_REC601;
+	case bmdColorspaceRec709:
+		return NOS_DECKLINK_COLORSPACE_REC709;
+	case bmdColorspaceRec2020:
+		return NOS_DECKLINK_COLORSPACE_REC2020;
+	}
+	return NOS_DECKLINK_COLORSPACE_UNKNOWN;
+}
+
+// DeckLink YUV and r210 buffers carry legal levels, the other RGB formats are full range.
+constexpr nosDeckLinkVideoRange GetVideoRangeOfDeckLinkPixelFormat(BMDPixelFormat fmt)
+{
+	switch (fmt)
+	{
+	case bmdFormat8BitYUV:
+	case bmdFormat10BitYUV:
+	case bmdFormat10BitRGB:
+		return NOS_DECKLINK_VIDEO_RANGE_NARROW;
+	}
+	return NOS_DECKLINK_VIDEO_RANGE_FULL;
+}
+
+constexpr BMDAudioSampleType GetDeckLinkAudioSampleType(nosDeckLinkAudioSampleType type)
+{
+	switch (type)
+	{
+	case NOS_DECKLINK_AUDIO_SAMPLE_TYPE_INT16:
+		return bmdAudioSampleType16bitInteger;
+	case NOS_DECKLINK_AUDIO_SAMPLE_TYPE_INT32:
+		return bmdAudioSampleType32bitInteger;
+	}
+	return bmdAudioSampleType32bitInteger;
+}
+
+constexpr BMDTimecodeFormat GetDeckLinkTimecodeFormat(nosDeckLinkTimecodeFormat format)
+{
+	switch (format)
+	{
+	case NOS_DECKLINK_TIMECODE_FORMAT_RP188_LTC:
+		return bmdTimecodeRP188LTC;
+	case NOS_DECKLINK_TIMECODE_FORMAT_RP188_VITC1:
+		return bmdTimecodeRP188VITC1;
+	case NOS_DECKLINK_TIMECODE_FORMAT_RP188_VITC2:
+		return bmdTimecodeRP188VITC2;
+	case NOS_DECKLINK_TIMECODE_FORMAT_RP188_HIGH_FRAME_RATE:
+		return bmdTimecodeRP188HighFrameRate;
+	case NOS_DECKLINK_TIMECODE_FORMAT_VITC:
+		return bmdTimecodeVITC;
+	case NOS_DECKLINK_TIMECODE_FORMAT_VITC_FIELD2:
+		return bmdTimecodeVITCField2;
+	}
+	return bmdTimecodeRP188Any;
+}
+
+constexpr nosDeckLinkAudioSampleType GetAudioSampleTypeFromDeckLink(BMDAudioSampleType type)
+{
+	if (type == bmdAudioSampleType16bitInteger)
+		return NOS_DECKLINK_AUDIO_SAMPLE_TYPE_INT16;
+	return NOS_DECKLINK_AUDIO_SAMPLE_TYPE_INT32;
+}
 	
 constexpr nosMediaIOFrameRate GetFrameRateFromDisplayMode(BMDDisplayMode displayMode)
 {
@@ -509,5 +575,40 @@ constexpr FrameGeometryAndRatePair GetFrameGeometryAndRatePairFromDeckLinkDispla
 	}
 }
 
+constexpr BMDLinkConfiguration GetDeckLinkLinkConfiguration(nosDeckLinkChannel channel)
+{
+	switch (channel)
+	{
+	case NOS_DECKLINK_CHANNEL_DUAL_LINK_1:
+	case NOS_DECKLINK_CHANNEL_DUAL_LINK_2:
+	case NOS_DECKLINK_CHANNEL_DUAL_LINK_3:
+	case NOS_DECKLINK_CHANNEL_DUAL_LINK_4:
+		return bmdLinkConfigurationDualLink;
+	case NOS_DECKLINK_CHANNEL_QUAD_LINK_1:
+	case NOS_DECKLINK_CHANNEL_QUAD_LINK_2:
+	case NOS_DECKLINK_CHANNEL_QUAD_LINK_SQUARE_DIVISION_1:
+	case NOS_DECKLINK_CHANNEL_QUAD_LINK_SQUARE_DIVISION_2:
+		return bmdLinkConfigurationQuadLink;
+	}
+	return bmdLinkConfigurationSingleLink;
+}
+
+constexpr bool IsSquareDivisionChannel(nosDeckLinkChannel channel)
+{
+	return channel == NOS_DECKLINK_CHANNEL_QUAD_LINK_SQUARE_DIVISION_1 || channel == NOS_DECKLINK_CHANNEL_QUAD_LINK_SQUARE_DIVISION_2;
+}
+
+constexpr BMDSupportedVideoModeFlags GetSupportedVideoModeFlagsOfChannel(nosDeckLinkChannel channel)
+{
+	switch (GetDeckLinkLinkConfiguration(channel))
+	{
+	case bmdLinkConfigurationDualLink:
+		return bmdSupportedVideoModeSDIDualLink;
+	case bmdLinkConfigurationQuadLink:
+		return bmdSupportedVideoModeSDIQuadLink;
+	}
+	return bmdSupportedVideoModeDefault;
+}
+
 const char* NOSAPI_CALL GetChannelName(nosDeckLinkChannel channel);
 }
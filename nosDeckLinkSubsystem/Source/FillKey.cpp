@@ -0,0 +1,90 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#include "FillKey.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NOS_DECKLINK_FILL_KEY_SSE2
+#endif
+
+namespace nos::decklink
+{
+
+static uint32_t SwapRedBlue(uint32_t pixel)
+{
+	return (pixel & 0xFF00FF00) | ((pixel >> 16) & 0xFF) | ((pixel & 0xFF) << 16);
+}
+
+static uint32_t KeyOf(uint32_t pixel)
+{
+	return (pixel >> 24) * 0x010101 | 0xFF000000;
+}
+
+#ifdef NOS_DECKLINK_FILL_KEY_SSE2
+static __m128i SwapRedBlue(__m128i pixels)
+{
+	const __m128i greenAlpha = _mm_set1_epi32(int(0xFF00FF00));
+	const __m128i lowByte = _mm_set1_epi32(0xFF);
+	__m128i red = _mm_slli_epi32(_mm_and_si128(pixels, lowByte), 16);
+	__m128i blue = _mm_and_si128(_mm_srli_epi32(pixels, 16), lowByte);
+	return _mm_or_si128(_mm_and_si128(pixels, greenAlpha), _mm_or_si128(red, blue));
+}
+
+static __m128i KeyOf(__m128i pixels)
+{
+	__m128i alpha = _mm_srli_epi32(pixels, 24);
+	__m128i key = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 8));
+	key = _mm_or_si128(key, _mm_slli_epi32(alpha, 16));
+	return _mm_or_si128(key, _mm_set1_epi32(int(0xFF000000)));
+}
+#endif
+
+void SwapRedBlue(const void* src, void* dst, size_t pixelCount)
+{
+	auto* in = static_cast<const uint8_t*>(src);
+	auto* out = static_cast<uint8_t*>(dst);
+	size_t i = 0;
+#ifdef NOS_DECKLINK_FILL_KEY_SSE2
+	for (; i + 4 <= pixelCount; i += 4)
+	{
+		__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), SwapRedBlue(pixels));
+	}
+#endif
+	for (; i < pixelCount; ++i)
+	{
+		uint32_t pixel;
+		std::memcpy(&pixel, in + i * 4, 4);
+		pixel = SwapRedBlue(pixel);
+		std::memcpy(out + i * 4, &pixel, 4);
+	}
+}
+
+void SplitFillAndKey(const void* src, void* fill, void* key, size_t pixelCount, bool srcIsRGBA)
+{
+	auto* in = static_cast<const uint8_t*>(src);
+	auto* fillOut = static_cast<uint8_t*>(fill);
+	auto* keyOut = static_cast<uint8_t*>(key);
+	size_t i = 0;
+#ifdef NOS_DECKLINK_FILL_KEY_SSE2
+	for (; i + 4 <= pixelCount; i += 4)
+	{
+		__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(fillOut + i * 4), srcIsRGBA ? SwapRedBlue(pixels) : pixels);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(keyOut + i * 4), KeyOf(pixels));
+	}
+#endif
+	for (; i < pixelCount; ++i)
+	{
+		uint32_t pixel;
+		std::memcpy(&pixel, in + i * 4, 4);
+		uint32_t fillPixel = srcIsRGBA ? SwapRedBlue(pixel) : pixel;
+		uint32_t keyPixel = KeyOf(pixel);
+		std::memcpy(fillOut + i * 4, &fillPixel, 4);
+		std::memcpy(keyOut + i * 4, &keyPixel, 4);
+	}
+}
+
+}
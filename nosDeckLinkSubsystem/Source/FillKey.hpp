@@ -0,0 +1,16 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#pragma once
+
+#include <cstddef>
+
+namespace nos::decklink
+{
+
+/// Copies 8-bit 4-channel pixels, swapping the first and third channels (RGBA <-> BGRA).
+void SwapRedBlue(const void* src, void* dst, size_t pixelCount);
+
+/// Splits RGBA or BGRA pixels into a BGRA fill and a BGRA key with alpha in every color channel.
+/// Fill colors are passed through as is, so a premultiplied source gives a shaped fill.
+void SplitFillAndKey(const void* src, void* fill, void* key, size_t pixelCount, bool srcIsRGBA);
+
+}
@@ -0,0 +1,546 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#include "FrameAllocator.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <utility>
+
+#include <Nodos/Modules.h>
+
+#include "EnumConversions.hpp"
+
+#if !_WIN32
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace nos::decklink
+{
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+static size_t AlignUp(size_t size, size_t alignment)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+static void WarnOnce(std::atomic_bool& warned, const char* message)
+{
+	if (!warned.exchange(true))
+		nosEngine.LogW("DeckLink: %s", message);
+}
+
+#if _WIN32
+
+FrameMemory AllocateFrameMemory(size_t size, FrameMemoryPolicy const& policy)
+{
+	FrameMemory memory{};
+	DWORD preferredNode = policy.NumaNode >= 0 ? (DWORD)policy.NumaNode : NUMA_NO_PREFERRED_NODE;
+	if (policy.HugePageMode != HugePages::None)
+	{
+		// Windows has no transparent huge pages, both modes use large pages. Requires SeLockMemoryPrivilege.
+		static std::atomic_bool warned = false;
+		if (size_t largePageSize = GetLargePageMinimum())
+		{
+			memory.Size = AlignUp(size, largePageSize);
+			memory.Data = VirtualAllocExNuma(GetCurrentProcess(), nullptr, memory.Size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, preferredNode);
+			if (memory.Data)
+				memory.PageSize = largePageSize;
+		}
+		if (!memory.Data)
+			WarnOnce(warned, "Large pages are not available (requires 'Lock pages in memory' privilege), using regular pages for frames");
+	}
+	if (!memory.Data)
+	{
+		SYSTEM_INFO systemInfo{};
+		GetSystemInfo(&systemInfo);
+		memory.Size = AlignUp(size, systemInfo.dwPageSize);
+		memory.PageSize = systemInfo.dwPageSize;
+		memory.Data = VirtualAllocExNuma(GetCurrentProcess(), nullptr, memory.Size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, preferredNode);
+	}
+	if (!memory.Data)
+		return {};
+	memory.NumaNode = policy.NumaNode;
+	std::memset(memory.Data, 0, memory.Size);
+	if (policy.LockInMemory && memory.PageSize < HUGE_PAGE_SIZE && !VirtualLock(memory.Data, memory.Size))
+	{
+		// Large pages are never paged out.
+		static std::atomic_bool warned = false;
+		WarnOnce(warned, "Failed to lock frame memory (working set of the process is too small), frames can be paged out");
+	}
+	return memory;
+}
+
+void FreeFrameMemory(FrameMemory& memory)
+{
+	if (memory.Data)
+		VirtualFree(memory.Data, 0, MEM_RELEASE);
+	memory = {};
+}
+
+#else
+
+// From linux/mempolicy.h, libnuma is not required for this.
+constexpr int MPOL_PREFERRED_POLICY = 1;
+constexpr size_t MAX_NUMA_NODES = 1024;
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << 26)
+#endif
+
+static bool BindToNumaNode(void* data, size_t size, int32_t numaNode)
+{
+	if (numaNode < 0 || numaNode >= (int32_t)MAX_NUMA_NODES)
+		return false;
+	constexpr size_t bitsPerLong = sizeof(unsigned long) * 8;
+	unsigned long nodeMask[MAX_NUMA_NODES / bitsPerLong] = {};
+	nodeMask[numaNode / bitsPerLong] = 1ul << (numaNode % bitsPerLong);
+	// Preferred rather than bind: Falling back to another node is better than failing to allocate.
+	return syscall(SYS_mbind, data, size, MPOL_PREFERRED_POLICY, nodeMask, MAX_NUMA_NODES + 1, 0) == 0;
+}
+
+static void* MapAnonymous(size_t size, int extraFlags = 0)
+{
+	void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+	return data == MAP_FAILED ? nullptr : data;
+}
+
+/// Over-maps and trims, so that the range starts on a huge page boundary and THP can back all of it.
+static void* MapAligned(size_t size, size_t alignment)
+{
+	size_t mapSize = size + alignment;
+	auto* base = (uint8_t*)MapAnonymous(mapSize);
+	if (!base)
+		return nullptr;
+	auto* aligned = (uint8_t*)AlignUp((uintptr_t)base, alignment);
+	if (aligned != base)
+		munmap(base, aligned - base);
+	if (size_t tail = (base + mapSize) - (aligned + size))
+		munmap(aligned + size, tail);
+	return aligned;
+}
+
+/// Bytes of the mapping containing data that are backed by transparent huge pages.
+static size_t GetAnonHugePageBytes(void* data)
+{
+	std::ifstream smaps("/proc/self/smaps");
+	std::string line;
+	bool inMapping = false;
+	while (std::getline(smaps, line))
+	{
+		uintptr_t start, end;
+		if (std::sscanf(line.c_str(), "%lx-%lx ", &start, &end) == 2)
+		{
+			inMapping = start <= (uintptr_t)data && (uintptr_t)data < end;
+			continue;
+		}
+		size_t kiloBytes;
+		if (inMapping && std::sscanf(line.c_str(), "AnonHugePages: %zu kB", &kiloBytes) == 1)
+			return kiloBytes * 1024;
+	}
+	return 0;
+}
+
+FrameMemory AllocateFrameMemory(size_t size, FrameMemoryPolicy const& policy)
+{
+	FrameMemory memory{};
+	bool transparent = false;
+	if (policy.HugePageMode == HugePages::Explicit)
+	{
+		static std::atomic_bool warned = false;
+		memory.Size = AlignUp(size, HUGE_PAGE_SIZE);
+		memory.Data = MapAnonymous(memory.Size, MAP_HUGETLB | MAP_HUGE_2MB);
+		if (memory.Data)
+			memory.PageSize = HUGE_PAGE_SIZE;
+		else
+			WarnOnce(warned, "Not enough reserved huge pages (see /proc/sys/vm/nr_hugepages), trying transparent huge pages for frames");
+	}
+	if (!memory.Data && policy.HugePageMode != HugePages::None)
+	{
+		static std::atomic_bool warned = false;
+		memory.Size = AlignUp(size, HUGE_PAGE_SIZE);
+		memory.Data = MapAligned(memory.Size, HUGE_PAGE_SIZE);
+		if (memory.Data && madvise(memory.Data, memory.Size, MADV_HUGEPAGE) == 0)
+			transparent = true;
+		else if (memory.Data)
+			WarnOnce(warned, "Transparent huge pages are not available, using regular pages for frames");
+	}
+	if (!memory.Data)
+	{
+		memory.Size = AlignUp(size, sysconf(_SC_PAGESIZE));
+		memory.Data = MapAnonymous(memory.Size);
+	}
+	if (!memory.Data)
+		return {};
+	if (policy.NumaNode >= 0)
+	{
+		if (BindToNumaNode(memory.Data, memory.Size, policy.NumaNode))
+			memory.NumaNode = policy.NumaNode;
+		else
+			nosEngine.LogW("DeckLink: Failed to bind frame memory to NUMA node %d, errno: %d", policy.NumaNode, errno);
+	}
+	// Fault the pages in now, under the memory policy, instead of on the first DMA transfer.
+	std::memset(memory.Data, 0, memory.Size);
+	if (policy.LockInMemory && mlock(memory.Data, memory.Size) != 0)
+	{
+		static std::atomic_bool warned = false;
+		WarnOnce(warned, "Failed to lock frame memory (raise RLIMIT_MEMLOCK or grant CAP_IPC_LOCK), frames can be paged out");
+	}
+	if (!memory.PageSize)
+	{
+		// THP is best effort (it can be disabled system-wide or memory can be fragmented), see what we actually got.
+		if (transparent && GetAnonHugePageBytes(memory.Data) >= memory.Size)
+			memory.PageSize = HUGE_PAGE_SIZE;
+		else
+			memory.PageSize = sysconf(_SC_PAGESIZE);
+	}
+	return memory;
+}
+
+void FreeFrameMemory(FrameMemory& memory)
+{
+	if (memory.Data)
+		munmap(memory.Data, memory.Size);
+	memory = {};
+}
+
+#endif
+
+static bool IsSameInterface(REFIID iid, REFIID other)
+{
+#if _WIN32
+	return IsEqualIID(iid, other);
+#else
+	return std::memcmp(&iid, &other, sizeof(REFIID)) == 0;
+#endif
+}
+
+class FrameBuffer : public Object<IDeckLinkVideoBuffer>
+{
+public:
+	FrameBuffer(FrameBufferPool* pool, FrameMemory memory)
+		: Pool(pool), Memory(memory)
+	{
+		Pool->AddRef();
+	}
+
+	HRESULT	STDMETHODCALLTYPE QueryInterface(REFIID iid, LPVOID *ppv) override
+	{
+		if (!ppv)
+			return E_INVALIDARG;
+		if (IsSameInterface(iid, IID_IDeckLinkVideoBuffer) || IsSameInterface(iid, IID_IUnknown))
+		{
+			AddRef();
+			*ppv = static_cast<IDeckLinkVideoBuffer*>(this);
+			return S_OK;
+		}
+		*ppv = nullptr;
+		return E_NOINTERFACE;
+	}
+
+	HRESULT STDMETHODCALLTYPE GetBytes(void** buffer) override
+	{
+		if (!buffer)
+			return E_INVALIDARG;
+		*buffer = Memory.Data;
+		return S_OK;
+	}
+	// Memory is always host accessible.
+	HRESULT STDMETHODCALLTYPE StartAccess(BMDBufferAccessFlags flags) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE EndAccess(BMDBufferAccessFlags flags) override { return S_OK; }
+
+protected:
+	~FrameBuffer() override
+	{
+		Pool->Recycle(Memory);
+		Pool->Release();
+	}
+
+	FrameBufferPool* Pool;
+	FrameMemory Memory;
+};
+
+SharedFramePool* SharedFramePool::SingleInstance = nullptr;
+
+SharedFramePool* SharedFramePool::Instance()
+{
+	static std::mutex instanceMutex;
+	std::unique_lock lock(instanceMutex);
+	if (!SingleInstance)
+		SingleInstance = new SharedFramePool;
+	return SingleInstance;
+}
+
+void SharedFramePool::Destroy()
+{
+	delete SingleInstance;
+	SingleInstance = nullptr;
+}
+
+SharedFramePool::~SharedFramePool()
+{
+	for (auto& [key, buffers] : IdleBuffers)
+		for (auto& memory : buffers)
+			FreeFrameMemory(memory);
+	// Leased buffers are freed when they are returned, by the pool of that time.
+	if (!Leases.empty())
+		nosEngine.LogW("DeckLink: %zu frame buffers are still leased from the shared pool", Leases.size());
+}
+
+void SharedFramePool::SetLimits(size_t memoryLimit, size_t channelQuota)
+{
+	std::unique_lock lock(Mutex);
+	MemoryLimit = memoryLimit;
+	ChannelQuota = channelQuota;
+}
+
+bool SharedFramePool::EvictIdleBuffer(BucketKey const& except, std::vector<FrameMemory>& outEvicted)
+{
+	std::vector<FrameMemory>* largest = nullptr;
+	size_t largestBytes = 0;
+	for (auto& [key, buffers] : IdleBuffers)
+	{
+		if (key == except || buffers.empty() || key.SizeClass * buffers.size() <= largestBytes)
+			continue;
+		largest = &buffers;
+		largestBytes = key.SizeClass * buffers.size();
+	}
+	if (!largest)
+		return false;
+	outEvicted.push_back(largest->back());
+	largest->pop_back();
+	ResidentBytes -= outEvicted.back().Size;
+	--BufferCount;
+	return true;
+}
+
+FrameMemory SharedFramePool::Lease(FramePoolOwner owner, size_t size, FrameMemoryPolicy const& policy)
+{
+	BucketKey key{
+		.SizeClass = AlignUp(size, SIZE_CLASS_GRANULARITY),
+		.NumaNode = policy.NumaNode,
+		.HugePageMode = policy.HugePageMode,
+		.LockInMemory = policy.LockInMemory,
+	};
+	FrameMemory memory{};
+	std::vector<FrameMemory> evicted;
+	{
+		std::unique_lock lock(Mutex);
+		if (ChannelQuota && LeasedBytesOfOwner[owner] + key.SizeClass > ChannelQuota)
+		{
+			++FailedLeaseCount;
+			return {};
+		}
+		auto& idle = IdleBuffers[key];
+		if (!idle.empty())
+		{
+			memory = idle.back();
+			idle.pop_back();
+			Leases[memory.Data] = {owner, key};
+			LeasedBytesOfOwner[owner] += memory.Size;
+			LeasedBytes += memory.Size;
+			return memory;
+		}
+		if (MemoryLimit)
+		{
+			// Bucket of the key has no idle buffers here, all idle memory can be evicted for it.
+			size_t idleBytes = 0;
+			for (auto& [idleKey, buffers] : IdleBuffers)
+				for (auto& buffer : buffers)
+					idleBytes += buffer.Size;
+			if (ResidentBytes + key.SizeClass > MemoryLimit + idleBytes)
+			{
+				++FailedLeaseCount;
+				return {};
+			}
+			while (ResidentBytes + key.SizeClass > MemoryLimit && EvictIdleBuffer(key, evicted))
+				;
+		}
+		// Reserved under the limit while the buffer is allocated outside the lock, it is faulted in as a whole.
+		ResidentBytes += key.SizeClass;
+	}
+	for (auto& buffer : evicted)
+		FreeFrameMemory(buffer);
+	memory = AllocateFrameMemory(key.SizeClass, policy);
+	std::unique_lock lock(Mutex);
+	ResidentBytes -= key.SizeClass;
+	if (!memory.Data)
+	{
+		++FailedLeaseCount;
+		return {};
+	}
+	ResidentBytes += memory.Size;
+	PeakResidentBytes = std::max(PeakResidentBytes, ResidentBytes);
+	++BufferCount;
+	Leases[memory.Data] = {owner, key};
+	LeasedBytesOfOwner[owner] += memory.Size;
+	LeasedBytes += memory.Size;
+	return memory;
+}
+
+void SharedFramePool::Return(FrameMemory memory)
+{
+	std::unique_lock lock(Mutex);
+	auto it = Leases.find(memory.Data);
+	if (it == Leases.end())
+	{
+		// Leased from a pool that is destroyed since.
+		lock.unlock();
+		FreeFrameMemory(memory);
+		return;
+	}
+	auto [owner, key] = it->second;
+	Leases.erase(it);
+	auto ownerIt = LeasedBytesOfOwner.find(owner);
+	ownerIt->second -= memory.Size;
+	if (!ownerIt->second)
+		LeasedBytesOfOwner.erase(ownerIt);
+	LeasedBytes -= memory.Size;
+	IdleBuffers[key].push_back(memory);
+}
+
+nosDeckLinkFramePoolUsage SharedFramePool::GetUsage()
+{
+	std::unique_lock lock(Mutex);
+	std::set<BucketKey> keys;
+	for (auto& [key, buffers] : IdleBuffers)
+		if (!buffers.empty())
+			keys.insert(key);
+	for (auto& [data, lease] : Leases)
+		keys.insert(lease.Key);
+	return nosDeckLinkFramePoolUsage{
+		.MemoryLimit = MemoryLimit,
+		.ChannelQuota = ChannelQuota,
+		.ResidentBytes = ResidentBytes,
+		.LeasedBytes = LeasedBytes,
+		.PeakResidentBytes = PeakResidentBytes,
+		.BufferCount = BufferCount,
+		.LeasedBufferCount = uint32_t(Leases.size()),
+		.SizeClassCount = uint32_t(keys.size()),
+		.FailedLeaseCount = FailedLeaseCount,
+	};
+}
+
+FrameBufferPool::FrameBufferPool(size_t bufferSize, FrameMemoryPolicy policy, FramePoolOwner owner, std::shared_ptr<ChannelMemoryCounters> memory)
+	: BufferSize(bufferSize), Policy(policy), Owner(owner), Memory(std::move(memory))
+{
+}
+
+FrameBufferPool::~FrameBufferPool()
+{
+	for (auto& memory : FreeBuffers)
+	{
+		Memory->Add(NOS_DECKLINK_MEMORY_PURPOSE_IDLE_FRAME_BUFFERS, -int64_t(memory.Size));
+		FreeFrameMemory(memory);
+	}
+}
+
+HRESULT FrameBufferPool::AllocateVideoBuffer(IDeckLinkVideoBuffer** allocatedBuffer)
+{
+	if (!allocatedBuffer)
+		return E_INVALIDARG;
+	FrameMemory memory;
+	if (Policy.SharedPool)
+	{
+		memory = SharedFramePool::Instance()->Lease(Owner, BufferSize, Policy);
+		if (!memory.Data)
+		{
+			std::unique_lock lock(Mutex);
+			// Input pools are asked for a buffer on every frame, so the refusal is only logged once.
+			if (!std::exchange(LeaseFailureLogged, true))
+				nosEngine.LogE("(Device %d) %s: Failed to lease frame buffer of size %zu from the shared pool, channel quota or pool memory limit is reached",
+							   Owner.DeviceIndex, GetChannelName(Owner.Channel), BufferSize);
+			*allocatedBuffer = nullptr;
+			return E_OUTOFMEMORY;
+		}
+		std::unique_lock lock(Mutex);
+		PageSize = Allocated ? std::min(PageSize, memory.PageSize) : memory.PageSize;
+		NumaNode = !Allocated || NumaNode == memory.NumaNode ? memory.NumaNode : -1;
+		Allocated = true;
+		LeaseFailureLogged = false;
+	}
+	else
+	{
+		std::unique_lock lock(Mutex);
+		if (!FreeBuffers.empty())
+		{
+			memory = FreeBuffers.back();
+			FreeBuffers.pop_back();
+			Memory->Add(NOS_DECKLINK_MEMORY_PURPOSE_IDLE_FRAME_BUFFERS, -int64_t(memory.Size));
+		}
+	}
+	if (!memory.Data)
+	{
+		// Only happens until the SDK has as many buffers as it cycles through.
+		memory = AllocateFrameMemory(BufferSize, Policy);
+		if (!memory.Data)
+		{
+			nosEngine.LogE("DeckLink: Failed to allocate frame buffer of size %zu", BufferSize);
+			*allocatedBuffer = nullptr;
+			return E_OUTOFMEMORY;
+		}
+		std::unique_lock lock(Mutex);
+		PageSize = Allocated ? std::min(PageSize, memory.PageSize) : memory.PageSize;
+		NumaNode = !Allocated || NumaNode == memory.NumaNode ? memory.NumaNode : -1;
+		Allocated = true;
+	}
+	*allocatedBuffer = new FrameBuffer(this, memory);
+	return S_OK;
+}
+
+void FrameBufferPool::Recycle(FrameMemory memory)
+{
+	if (Policy.SharedPool)
+		return SharedFramePool::Instance()->Return(memory);
+	std::unique_lock lock(Mutex);
+	FreeBuffers.push_back(memory);
+	Memory->Add(NOS_DECKLINK_MEMORY_PURPOSE_IDLE_FRAME_BUFFERS, int64_t(memory.Size));
+}
+
+std::pair<size_t, int32_t> FrameBufferPool::GetPlacement()
+{
+	std::unique_lock lock(Mutex);
+	return {PageSize, NumaNode};
+}
+
+FrameAllocatorProvider::FrameAllocatorProvider(FrameMemoryPolicy policy, FramePoolOwner owner, std::shared_ptr<ChannelMemoryCounters> memory)
+	: Policy(policy), Owner(owner), Memory(std::move(memory))
+{
+}
+
+FrameAllocatorProvider::~FrameAllocatorProvider()
+{
+	if (Pool)
+		Pool->Release();
+}
+
+HRESULT FrameAllocatorProvider::GetVideoBufferAllocator(uint32_t bufferSize, uint32_t width, uint32_t height, uint32_t rowBytes, BMDPixelFormat pixelFormat, IDeckLinkVideoBufferAllocator** allocator)
+{
+	if (!allocator)
+		return E_INVALIDARG;
+	std::unique_lock lock(Mutex);
+	if (!Pool || Pool->BufferSize != bufferSize)
+	{
+		if (Pool)
+			Pool->Release();
+		Pool = new FrameBufferPool(bufferSize, Policy, Owner, Memory);
+	}
+	Pool->AddRef();
+	*allocator = Pool;
+	return S_OK;
+}
+
+std::pair<size_t, int32_t> FrameAllocatorProvider::GetPlacement()
+{
+	std::unique_lock lock(Mutex);
+	if (!Pool)
+		return {0, -1};
+	return Pool->GetPlacement();
+}
+
+}
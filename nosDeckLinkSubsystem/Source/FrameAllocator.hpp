@@ -0,0 +1,141 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Common.hpp"
+
+namespace nos::decklink
+{
+
+struct FrameMemory
+{
+	void* Data = nullptr;
+	size_t Size = 0; // Mapped size, rounded up to PageSize
+	size_t PageSize = 0;
+	int32_t NumaNode = -1; // Node the memory is bound to, -1 if it is not bound to a node.
+};
+
+/// Page aligned, pre-faulted memory for a video frame, placed as the policy asks when possible.
+/// Explicit huge pages fall back to transparent ones, and those fall back to regular pages.
+FrameMemory AllocateFrameMemory(size_t size, FrameMemoryPolicy const& policy);
+void FreeFrameMemory(FrameMemory& memory);
+
+struct FramePoolOwner
+{
+	uint32_t DeviceIndex = -1;
+	nosDeckLinkChannel Channel = NOS_DECKLINK_CHANNEL_INVALID;
+
+	auto operator<=>(FramePoolOwner const&) const = default;
+};
+
+/// Frame memory shared by the channels of all devices. Buffers are bucketed by size class and placement, so a buffer
+/// returned by one channel is leased again by any channel with frames of the same size class and memory policy.
+/// Idle buffers are kept, and only freed when memory is needed for another bucket under the memory limit.
+class SharedFramePool
+{
+public:
+	static constexpr size_t SIZE_CLASS_GRANULARITY = 2 * 1024 * 1024;
+
+	static SharedFramePool* Instance();
+	static void Destroy();
+
+	/// In bytes, 0 for no limit. Buffers leased already are not taken back.
+	void SetLimits(size_t memoryLimit, size_t channelQuota);
+	/// Memory is null if the channel is over its quota, the pool is over its limit or allocation fails.
+	/// Size of the memory is the size class, which can be larger than the requested size.
+	FrameMemory Lease(FramePoolOwner owner, size_t size, FrameMemoryPolicy const& policy);
+	void Return(FrameMemory memory);
+	nosDeckLinkFramePoolUsage GetUsage();
+
+protected:
+	~SharedFramePool();
+
+	struct BucketKey
+	{
+		size_t SizeClass = 0;
+		int32_t NumaNode = -1;
+		HugePages HugePageMode = HugePages::None;
+		bool LockInMemory = false;
+
+		auto operator<=>(BucketKey const&) const = default;
+	};
+	struct LeaseInfo
+	{
+		FramePoolOwner Owner;
+		BucketKey Key;
+	};
+
+	// Takes an idle buffer out of the bucket with the most idle memory, other than except. Called with Mutex held.
+	bool EvictIdleBuffer(BucketKey const& except, std::vector<FrameMemory>& outEvicted);
+
+	std::mutex Mutex;
+	std::map<BucketKey, std::vector<FrameMemory>> IdleBuffers;
+	std::unordered_map<void*, LeaseInfo> Leases;
+	std::map<FramePoolOwner, size_t> LeasedBytesOfOwner;
+	size_t MemoryLimit = 0;
+	size_t ChannelQuota = 0;
+	size_t ResidentBytes = 0; // Includes allocations in progress
+	size_t LeasedBytes = 0;
+	size_t PeakResidentBytes = 0;
+	uint32_t BufferCount = 0;
+	uint64_t FailedLeaseCount = 0;
+
+	static SharedFramePool* SingleInstance;
+};
+
+/// Fixed size frame buffers placed as the policy asks. Buffers are handed out as IDeckLinkVideoBuffer,
+/// and go back to the pool once the SDK or we release them. Every buffer keeps a reference to the pool.
+/// With a shared pool policy, buffers are leased from SharedFramePool for the owner channel instead of being kept here.
+class FrameBufferPool : public Object<IDeckLinkVideoBufferAllocator>
+{
+public:
+	FrameBufferPool(size_t bufferSize, FrameMemoryPolicy policy, FramePoolOwner owner, std::shared_ptr<ChannelMemoryCounters> memory);
+
+	HRESULT STDMETHODCALLTYPE AllocateVideoBuffer(IDeckLinkVideoBuffer** allocatedBuffer) override;
+	void Recycle(FrameMemory memory);
+
+	/// Smallest page size and common NUMA node of the buffers allocated so far.
+	std::pair<size_t, int32_t> GetPlacement();
+
+	const size_t BufferSize;
+	const FrameMemoryPolicy Policy;
+	const FramePoolOwner Owner;
+
+protected:
+	~FrameBufferPool() override;
+
+	std::shared_ptr<ChannelMemoryCounters> Memory; // Idle buffers are accounted to the owner channel
+
+	std::mutex Mutex;
+	std::vector<FrameMemory> FreeBuffers;
+	size_t PageSize = 0;
+	int32_t NumaNode = -1;
+	bool Allocated = false;
+	bool LeaseFailureLogged = false;
+};
+
+/// Hands out a FrameBufferPool for the frame size of the input signal. The pool is kept as long as the size is the same.
+class FrameAllocatorProvider : public Object<IDeckLinkVideoBufferAllocatorProvider>
+{
+public:
+	FrameAllocatorProvider(FrameMemoryPolicy policy, FramePoolOwner owner, std::shared_ptr<ChannelMemoryCounters> memory);
+
+	HRESULT STDMETHODCALLTYPE GetVideoBufferAllocator(uint32_t bufferSize, uint32_t width, uint32_t height, uint32_t rowBytes, BMDPixelFormat pixelFormat, IDeckLinkVideoBufferAllocator** allocator) override;
+	std::pair<size_t, int32_t> GetPlacement();
+
+	const FrameMemoryPolicy Policy;
+	const FramePoolOwner Owner;
+
+protected:
+	~FrameAllocatorProvider() override;
+
+	std::shared_ptr<ChannelMemoryCounters> Memory;
+	std::mutex Mutex;
+	FrameBufferPool* Pool = nullptr;
+};
+
+}
@@ -0,0 +1,97 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#include "HDRMetadata.hpp"
+
+#include "EnumConversions.hpp"
+
+namespace nos::decklink
+{
+
+static nosDeckLinkHDRMetadata ReadHDRMetadata(IDeckLinkVideoFrameMetadataExtensions* extensions)
+{
+	nosDeckLinkHDRMetadata metadata{};
+	int64_t eotf = 0;
+	if (extensions->GetInt(bmdDeckLinkFrameMetadataHDRElectroOpticalTransferFunc, &eotf) == S_OK)
+	{
+		metadata.Present = true;
+		metadata.EOTF = nosDeckLinkEOTF(eotf);
+		extensions->GetFloat(bmdDeckLinkFrameMetadataHDRDisplayPrimariesRedX, &metadata.RedPrimary.X);
+		extensions->GetFloat(bmdDeckLinkFrameMetadataHDRDisplayPrimariesRedY, &metadata.RedPrimary.Y);
+		extensions->GetFloat(bmdDeckLinkFrameMetadataHDRDisplayPrimariesGreenX, &metadata.GreenPrimary.X);
+		extensions->GetFloat(bmdDeckLinkFrameMetadataHDRDisplayPrimariesGreenY, &metadata.GreenPrimary.Y);
+		extensions->GetFloat(bmdDeckLinkFrameMetadataHDRDisplayPrimariesBlueX, &metadata.BluePrimary.X);
+		extensions->GetFloat(bmdDeckLinkFrameMetadataHDRDisplayPrimariesBlueY, &metadata.BluePrimary.Y);
+		extensions->GetFloat(bmdDeckLinkFrameMetadataHDRWhitePointX, &metadata.WhitePoint.X);
+		extensions->GetFloat(bmdDeckLinkFrameMetadataHDRWhitePointY, &metadata.WhitePoint.Y);
+		extensions->GetFloat(bmdDeckLinkFrameMetadataHDRMaxDisplayMasteringLuminance, &metadata.MaxDisplayMasteringLuminance);
+		extensions->GetFloat(bmdDeckLinkFrameMetadataHDRMinDisplayMasteringLuminance, &metadata.MinDisplayMasteringLuminance);
+		extensions->GetFloat(bmdDeckLinkFrameMetadataHDRMaximumContentLightLevel, &metadata.MaxContentLightLevel);
+		extensions->GetFloat(bmdDeckLinkFrameMetadataHDRMaximumFrameAverageLightLevel, &metadata.MaxFrameAverageLightLevel);
+	}
+	return metadata;
+}
+
+void ReadColorimetry(IDeckLinkVideoFrame* frame, nosDeckLinkColorspace& inOutColorspace, nosDeckLinkHDRMetadata& outHDR)
+{
+	outHDR = {};
+	IDeckLinkVideoFrameMetadataExtensions* extensions = nullptr;
+	if (frame->QueryInterface(IID_IDeckLinkVideoFrameMetadataExtensions, (void**)&extensions) != S_OK || !extensions)
+		return;
+	int64_t colorspace = 0;
+	if (extensions->GetInt(bmdDeckLinkFrameMetadataColorspace, &colorspace) == S_OK)
+		if (auto detected = GetColorspaceFromDeckLink(BMDColorspace(colorspace)); detected != NOS_DECKLINK_COLORSPACE_UNKNOWN)
+			inOutColorspace = detected;
+	if (frame->GetFlags() & bmdFrameContainsHDRMetadata)
+		outHDR = ReadHDRMetadata(extensions);
+	Release(extensions);
+}
+
+bool WriteHDRMetadata(IDeckLinkMutableVideoFrame* frame, nosDeckLinkHDRMetadata const& metadata)
+{
+	auto flags = frame->GetFlags();
+	if (!metadata.Present)
+		return frame->SetFlags(flags & ~bmdFrameContainsHDRMetadata) == S_OK;
+	IDeckLinkVideoFrameMutableMetadataExtensions* extensions = nullptr;
+	if (frame->QueryInterface(IID_IDeckLinkVideoFrameMutableMetadataExtensions, (void**)&extensions) != S_OK || !extensions)
+		return false;
+	bool ok = extensions->SetInt(bmdDeckLinkFrameMetadataHDRElectroOpticalTransferFunc, metadata.EOTF) == S_OK;
+	ok &= extensions->SetFloat(bmdDeckLinkFrameMetadataHDRDisplayPrimariesRedX, metadata.RedPrimary.X) == S_OK;
+	ok &= extensions->SetFloat(bmdDeckLinkFrameMetadataHDRDisplayPrimariesRedY, metadata.RedPrimary.Y) == S_OK;
+	ok &= extensions->SetFloat(bmdDeckLinkFrameMetadataHDRDisplayPrimariesGreenX, metadata.GreenPrimary.X) == S_OK;
+	ok &= extensions->SetFloat(bmdDeckLinkFrameMetadataHDRDisplayPrimariesGreenY, metadata.GreenPrimary.Y) == S_OK;
+	ok &= extensions->SetFloat(bmdDeckLinkFrameMetadataHDRDisplayPrimariesBlueX, metadata.BluePrimary.X) == S_OK;
+	ok &= extensions->SetFloat(bmdDeckLinkFrameMetadataHDRDisplayPrimariesBlueY, metadata.BluePrimary.Y) == S_OK;
+	ok &= extensions->SetFloat(bmdDeckLinkFrameMetadataHDRWhitePointX, metadata.WhitePoint.X) == S_OK;
+	ok &= extensions->SetFloat(bmdDeckLinkFrameMetadataHDRWhitePointY, metadata.WhitePoint.Y) == S_OK;
+	ok &= extensions->SetFloat(bmdDeckLinkFrameMetadataHDRMaxDisplayMasteringLuminance, metadata.MaxDisplayMasteringLuminance) == S_OK;
+	ok &= extensions->SetFloat(bmdDeckLinkFrameMetadataHDRMinDisplayMasteringLuminance, metadata.MinDisplayMasteringLuminance) == S_OK;
+	ok &= extensions->SetFloat(bmdDeckLinkFrameMetadataHDRMaximumContentLightLevel, metadata.MaxContentLightLevel) == S_OK;
+	ok &= extensions->SetFloat(bmdDeckLinkFrameMetadataHDRMaximumFrameAverageLightLevel, metadata.MaxFrameAverageLightLevel) == S_OK;
+	Release(extensions);
+	if (!ok)
+		return false;
+	return frame->SetFlags(flags | bmdFrameContainsHDRMetadata) == S_OK;
+}
+
+static bool operator==(nosDeckLinkChromaticity const& lhs, nosDeckLinkChromaticity const& rhs)
+{
+	return lhs.X == rhs.X && lhs.Y == rhs.Y;
+}
+
+bool IsSameHDRMetadata(nosDeckLinkHDRMetadata const& lhs, nosDeckLinkHDRMetadata const& rhs)
+{
+	if (lhs.Present != rhs.Present)
+		return false;
+	if (!lhs.Present)
+		return true;
+	return lhs.EOTF == rhs.EOTF &&
+		lhs.RedPrimary == rhs.RedPrimary &&
+		lhs.GreenPrimary == rhs.GreenPrimary &&
+		lhs.BluePrimary == rhs.BluePrimary &&
+		lhs.WhitePoint == rhs.WhitePoint &&
+		lhs.MaxDisplayMasteringLuminance == rhs.MaxDisplayMasteringLuminance &&
+		lhs.MinDisplayMasteringLuminance == rhs.MinDisplayMasteringLuminance &&
+		lhs.MaxContentLightLevel == rhs.MaxContentLightLevel &&
+		lhs.MaxFrameAverageLightLevel == rhs.MaxFrameAverageLightLevel;
+}
+
+}
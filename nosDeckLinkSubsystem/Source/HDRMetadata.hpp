@@ -0,0 +1,17 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#pragma once
+
+#include "Common.hpp"
+
+namespace nos::decklink
+{
+
+/// Reads the colorspace and HDR metadata of an input frame with a single metadata interface query.
+/// HDR Present is false if the frame is not flagged with bmdFrameContainsHDRMetadata,
+/// colorspace is left as is if the frame does not carry it.
+void ReadColorimetry(IDeckLinkVideoFrame* frame, nosDeckLinkColorspace& inOutColorspace, nosDeckLinkHDRMetadata& outHDR);
+/// Sets or clears the HDR metadata of an output frame.
+bool WriteHDRMetadata(IDeckLinkMutableVideoFrame* frame, nosDeckLinkHDRMetadata const& metadata);
+bool IsSameHDRMetadata(nosDeckLinkHDRMetadata const& lhs, nosDeckLinkHDRMetadata const& rhs);
+
+}
@@ -6,6 +6,8 @@
 
 #include "EnumConversions.hpp"
 #include "VideoFrame.hpp"
+#include "Timecode.hpp"
+#include "HDRMetadata.hpp"
 
 namespace nos::decklink
 {
@@ -25,7 +27,6 @@ public:
 	HRESULT		STDMETHODCALLTYPE VideoInputFormatChanged (/* in */ BMDVideoInputFormatChangedEvents notificationEvents, /* in */ IDeckLinkDisplayMode *newDisplayMode, /* in */ BMDDetectedVideoInputFormatFlags detectedSignalFlags)
 	{
 		BMDPixelFormat      pixelFormat = bmdFormat10BitYUV;
-		BMDVideoInputFlags  videoInputFlags = bmdVideoInputEnableFormatDetection;
 		
 		// // Check for video field changes
 		if (notificationEvents & bmdVideoInputFieldDominanceChanged)
@@ -60,24 +61,9 @@ public:
 			}
 		}
 		
-		// Check if the video mode has changed
-		if (notificationEvents & bmdVideoInputDisplayModeChanged)
-		{
-			// Obtain the name of the video mode
-			dlstring_t displayModeString;
-			if (newDisplayMode->GetName(&displayModeString) == S_OK)
-			{
-				std::string modeName = DlToStdString(displayModeString);
-				if (detectedSignalFlags & bmdDetectedVideoInputDualStream3D)
-					videoInputFlags |= bmdVideoInputDualStream3D;
-				// Release the video mode name string
-				DeleteString(displayModeString);
-			}
-		}
-		
 		if (notificationEvents & (bmdVideoInputDisplayModeChanged | bmdVideoInputColorspaceChanged))
 		{
-			Input->OnInputVideoFormatChanged_DeckLinkThread(newDisplayMode->GetDisplayMode(), pixelFormat);
+			Input->OnInputVideoFormatChanged_DeckLinkThread(newDisplayMode->GetDisplayMode(), pixelFormat, detectedSignalFlags & bmdDetectedVideoInputDualStream3D);
 		}
 		
 		return S_OK;
@@ -85,7 +71,9 @@ public:
 
 	HRESULT STDMETHODCALLTYPE VideoInputFrameArrived (/* in */ IDeckLinkVideoInputFrame* videoFrame, /* in */ IDeckLinkAudioInputPacket* audioPacket)
 	{
-		Input->OnInputFrameArrived_DeckLinkThread(videoFrame);
+		if (!videoFrame)
+			return S_OK;
+		Input->OnInputFrameArrived_DeckLinkThread(videoFrame, audioPacket);
 		return S_OK;
 	}
 
@@ -97,10 +85,16 @@ private:
 InputHandler::~InputHandler()
 {
 	CloseStream();
+	Release(AllocatorProvider);
+	Release(Status);
 	Release(Interface);
+	// Freed along with the handler, device totals should not keep them.
+	Memory->Set(NOS_DECKLINK_MEMORY_PURPOSE_INPUT_FRAME_QUEUE, 0);
+	Memory->Set(NOS_DECKLINK_MEMORY_PURPOSE_AUDIO, 0);
+	Memory->Set(NOS_DECKLINK_MEMORY_PURPOSE_ANCILLARY, 0);
 }
 
-void InputHandler::OnInputFrameArrived_DeckLinkThread(IDeckLinkVideoInputFrame* frame)
+void InputHandler::OnInputFrameArrived_DeckLinkThread(IDeckLinkVideoInputFrame* frame, IDeckLinkAudioInputPacket* audioPacket)
 {
 	BMDTimeValue frameTime, frameDuration;
 	auto res = frame->GetStreamTime(&frameTime, &frameDuration, TimeScale);
@@ -111,16 +105,67 @@ void InputHandler::OnInputFrameArrived_DeckLinkThread(IDeckLinkVideoInputFrame*
 		std::unique_lock lock(ReadFramesMutex);
 		if (ReadFrames.size() > 1)
 		{
+			++FramesDropped;
 			OnFrameEnd(NOS_DECKLINK_FRAME_DROPPED);
 			return;
 		}
 	}
+	++FramesCompleted;
 	OnFrameEnd(NOS_DECKLINK_FRAME_COMPLETED);
-	auto inputFrame = std::make_unique<VideoFrame>(frame);
-	inputFrame->StartAccess(bmdBufferAccessRead);
+	nosDeckLinkColorspace colorspace = CurrentFormat.Colorspace;
+	nosDeckLinkHDRMetadata hdr;
+	ReadColorimetry(frame, colorspace, hdr);
+	if (colorspace != CurrentFormat.Colorspace || !IsSameHDRMetadata(hdr, CurrentFormat.HDR))
+	{
+		CurrentFormat.Colorspace = colorspace;
+		CurrentFormat.HDR = hdr;
+		CallbackDispatcher::Instance()->PostInputVideoFormatChanged(Callbacks, CurrentFormat, false);
+	}
+	InputFrame inputFrame{
+		.Video = std::make_unique<VideoFrame>(frame),
+		.Ancillary = {nullptr, {&AncillaryArenas}},
+		.FrameTime = frameTime,
+		.FrameDuration = frameDuration,
+		.Timecodes = ReadTimecodes(frame),
+	};
+	inputFrame.Video->StartAccess(bmdBufferAccessRead);
+	if (DualStream3D)
+	{
+		IDeckLinkVideoFrame3DExtensions* extensions = nullptr;
+		if (frame->QueryInterface(IID_IDeckLinkVideoFrame3DExtensions, (void**)&extensions) == S_OK && extensions)
+		{
+			IDeckLinkVideoFrame* rightEye = nullptr;
+			if (extensions->GetFrameForRightEye(&rightEye) == S_OK && rightEye)
+			{
+				inputFrame.RightEye = std::make_unique<VideoFrame>(rightEye);
+				inputFrame.RightEye->StartAccess(bmdBufferAccessRead);
+				Release(rightEye);
+			}
+			Release(extensions);
+		}
+	}
+	void* samples = nullptr;
+	if (audioPacket && Audio.IsEnabled() && audioPacket->GetBytes(&samples) == S_OK)
+	{
+		AudioPacket audio{.SampleFrameCount = (uint32_t)audioPacket->GetSampleFrameCount(), .FrameTime = frameTime};
+		if (audioPacket->GetPacketTime(&audio.PacketTime, TimeScale) != S_OK)
+			audio.PacketTime = frameTime;
+		audio.Position = AudioRing.Write(samples, size_t(audio.SampleFrameCount) * Audio.GetBytesPerSampleFrame());
+		inputFrame.Audio = audio;
+	}
+	if (CaptureAncillaryPackets)
+	{
+		inputFrame.Ancillary = AncillaryArenas.Acquire();
+		if (inputFrame.Ancillary)
+		{
+			inputFrame.Ancillary->FrameTime = frameTime;
+			inputFrame.Ancillary->Gather(frame);
+		}
+	}
 	{
 		std::unique_lock lock(ReadFramesMutex);
 		ReadFrames.push_back(std::move(inputFrame));
+		UpdateQueuedFrameMemory();
 		char buffer[256];
 		snprintf(buffer, sizeof(buffer), "DeckLink %d:%s Input Queue Size", DeviceIndex, GetChannelName(Channel));
 		nosEngine.WatchLog(buffer, std::to_string(ReadFrames.size()).c_str());
@@ -140,6 +185,10 @@ bool InputHandler::Flush()
 
 	std::unique_lock lock(ReadFramesMutex);
 	ReadFrames.clear();
+	UpdateQueuedFrameMemory();
+	LastReadAudio = std::nullopt;
+	LastReadAncillary.reset();
+	LastReadFrameInfo = std::nullopt;
 
 	return true;
 }
@@ -162,12 +211,32 @@ bool InputHandler::Open(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat)
 		return false;
 	}
 	Release(callback);
-	res = Interface->EnableVideoInput(displayMode, pixelFormat, bmdVideoInputEnableFormatDetection);
+	res = EnableVideoInput(displayMode, pixelFormat);
 	if (res != S_OK)
 	{
 		nosEngine.LogE("Could not enable video input - result = %08x", res);
 		return false;
 	}
+	if (Audio.IsEnabled())
+	{
+		res = Interface->EnableAudioInput(bmdAudioSampleRate48kHz, Audio.SampleType, Audio.ChannelCount);
+		if (res != S_OK)
+		{
+			nosEngine.LogE("Could not enable audio input with %u channels - result = %08x", Audio.ChannelCount, res);
+			Interface->DisableVideoInput();
+			return false;
+		}
+		// Holds a second of audio, so samples outlive the frames they arrived with even if reading falls behind.
+		AudioRing.Allocate(size_t(bmdAudioSampleRate48kHz) * Audio.GetBytesPerSampleFrame());
+		Memory->Set(NOS_DECKLINK_MEMORY_PURPOSE_AUDIO, AudioRing.GetCapacity());
+	}
+	if (CaptureAncillaryPackets)
+	{
+		// Two queued frames, the one being received and the last read one.
+		// 8 bit packets are at most 255 bytes, so a frame fits 128 full packets.
+		AncillaryArenas.Allocate(4, 128, 128 * 255);
+		Memory->Set(NOS_DECKLINK_MEMORY_PURPOSE_ANCILLARY, AncillaryArenas.GetMemorySize());
+	}
 	{
 		IDeckLinkDisplayMode* displayModeInterface = nullptr;
 		res = Interface->GetDisplayMode(displayMode, &displayModeInterface);
@@ -178,6 +247,14 @@ bool InputHandler::Open(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat)
 			return false;
 		Release(displayModeInterface);
 	}
+	auto [frameGeometry, frameRate] = GetFrameGeometryAndRatePairFromDeckLinkDisplayMode(displayMode);
+	CurrentFormat = nosDeckLinkInputVideoFormat{
+		.Geometry = frameGeometry,
+		.FrameRate = frameRate,
+		.PixelFormat = GetPixelFormatFromDeckLink(pixelFormat),
+		.Colorspace = GetDetectedColorspace(),
+		.Range = GetVideoRangeOfDeckLinkPixelFormat(pixelFormat),
+	};
 	return true;
 }
 
@@ -198,11 +275,55 @@ bool InputHandler::Stop()
 
 bool InputHandler::Close()
 {
+	if (Audio.IsEnabled())
+		Interface->DisableAudioInput();
 	if (S_OK != Interface->DisableVideoInput())
 		return false;
+	Release(AllocatorProvider);
+	AudioRing.Free();
+	Memory->Set(NOS_DECKLINK_MEMORY_PURPOSE_AUDIO, 0);
+	{
+		std::unique_lock lock(ReadFramesMutex);
+		ReadFrames.clear();
+		UpdateQueuedFrameMemory();
+		LastReadAudio = std::nullopt;
+		LastReadAncillary.reset();
+		LastReadFrameInfo = std::nullopt;
+	}
+	// Frames holding arenas are gone, Open allocates them again if ancillary packets are captured.
+	if (AncillaryArenas.Free())
+		Memory->Set(NOS_DECKLINK_MEMORY_PURPOSE_ANCILLARY, 0);
 	return true;
 }
 
+HRESULT InputHandler::EnableVideoInput(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat)
+{
+	BMDVideoInputFlags flags = bmdVideoInputEnableFormatDetection;
+	if (DualStream3D)
+		flags |= bmdVideoInputDualStream3D;
+	if (!FrameMemory.UseFrameAllocator())
+		return Interface->EnableVideoInput(displayMode, pixelFormat, flags);
+	if (!AllocatorProvider)
+		AllocatorProvider = new FrameAllocatorProvider(FrameMemory, {DeviceIndex, Channel}, Memory);
+	// Right eye frames come from the same allocator, so they follow the same memory policy.
+	return Interface->EnableVideoInputWithAllocatorProvider(displayMode, pixelFormat, flags, AllocatorProvider);
+}
+
+void InputHandler::UpdateQueuedFrameMemory()
+{
+	size_t bytes = 0;
+	for (auto& frame : ReadFrames)
+		bytes += frame.Video->Size + (frame.RightEye ? frame.RightEye->Size : 0);
+	Memory->Set(NOS_DECKLINK_MEMORY_PURPOSE_INPUT_FRAME_QUEUE, bytes);
+}
+
+std::pair<size_t, int32_t> InputHandler::GetFrameMemoryPlacement()
+{
+	if (!AllocatorProvider)
+		return {0, -1};
+	return AllocatorProvider->GetPlacement();
+}
+
 bool InputHandler::WaitFrame(std::chrono::milliseconds timeout)
 {
 	util::Stopwatch sw;
@@ -225,7 +346,7 @@ bool InputHandler::WaitFrame(std::chrono::milliseconds timeout)
 	return res;
 }
 
-void InputHandler::DmaTransfer(void* buffer, size_t size)
+bool InputHandler::DmaTransfer(void* buffer, size_t size)
 {
 	util::Stopwatch sw;
 	{
@@ -233,63 +354,169 @@ void InputHandler::DmaTransfer(void* buffer, size_t size)
 		if (ReadFrames.empty())
 		{
 			nosEngine.LogE("(Device %d) %s DMA Read: No frame available to read", DeviceIndex, GetChannelName(Channel));
-			return;
+			// Audio, ancillary packets and timecodes must not be attributed to a frame that was not read.
+			LastReadAudio = std::nullopt;
+			LastReadAncillary.reset();
+			LastReadFrameInfo = std::nullopt;
+			return false;
 		}
 		auto readFrame = std::move(ReadFrames.front());
 		ReadFrames.pop_front();
-		size_t actualSize = readFrame->Size;
+		UpdateQueuedFrameMemory();
+		LastReadAudio = readFrame.Audio;
+		LastReadAncillary = std::move(readFrame.Ancillary);
+		LastReadFrameInfo = nosDeckLinkFrameInfo{.FrameTime = readFrame.FrameTime, .FrameDuration = readFrame.FrameDuration, .HasRightEye = readFrame.RightEye != nullptr};
+		std::copy(readFrame.Timecodes.begin(), readFrame.Timecodes.end(), LastReadFrameInfo->Timecodes);
+		size_t actualSize = readFrame.Video->Size;
 		if (!actualSize)
-			return;
-		if (size != actualSize)
+			return true;
+		// Eyes are packed back to back, so 3D channels expect two frames worth of buffer.
+		size_t expectedSize = DualStream3D ? actualSize * 2 : actualSize;
+		if (size != expectedSize)
 		{
 			nosEngine.LogW("(Device %d) %s DMA Read: Buffer size does not match frame size", DeviceIndex, GetChannelName(Channel));
 		}
 		auto copySize = std::min(actualSize, size);
-		std::memcpy(buffer, readFrame->GetBytes(), copySize);
-		readFrame->EndAccess();
+		std::memcpy(buffer, readFrame.Video->GetBytes(), copySize);
+		readFrame.Video->EndAccess();
+		if (readFrame.RightEye)
+		{
+			if (size >= actualSize + readFrame.RightEye->Size)
+				std::memcpy(static_cast<uint8_t*>(buffer) + actualSize, readFrame.RightEye->GetBytes(), readFrame.RightEye->Size);
+			else
+				LastReadFrameInfo->HasRightEye = false;
+			readFrame.RightEye->EndAccess();
+		}
 	}
 	auto seconds = sw.Elapsed();
 	char watchLogBuf[128];
 	snprintf(watchLogBuf, sizeof(watchLogBuf), "DeckLink %d:%s DMARead", DeviceIndex, GetChannelName(Channel));
 	nosEngine.WatchLog(watchLogBuf, util::Stopwatch::ElapsedString(seconds).c_str());
+	return true;
 }
 
-void InputHandler::OnInputVideoFormatChanged_DeckLinkThread(BMDDisplayMode newDisplayMode, BMDPixelFormat pixelFormat)
+bool InputHandler::ReadAudio(void* buffer, size_t size, nosDeckLinkAudioPacketInfo& outInfo)
+{
+	if (!Audio.IsEnabled())
+	{
+		nosEngine.LogE("(Device %d) %s Audio Read: Audio is not enabled", DeviceIndex, GetChannelName(Channel));
+		return false;
+	}
+	std::optional<AudioPacket> packet;
+	{
+		std::unique_lock lock(ReadFramesMutex);
+		packet = LastReadAudio;
+	}
+	if (!packet)
+	{
+		nosEngine.LogE("(Device %d) %s Audio Read: No audio arrived with the last read frame", DeviceIndex, GetChannelName(Channel));
+		return false;
+	}
+	outInfo = nosDeckLinkAudioPacketInfo{
+		.PacketTime = packet->PacketTime,
+		.FrameTime = packet->FrameTime,
+		.SampleFrameCount = packet->SampleFrameCount,
+		.ChannelCount = Audio.ChannelCount,
+		.SampleType = GetAudioSampleTypeFromDeckLink(Audio.SampleType),
+	};
+	if (!buffer)
+		return true;
+	size_t actualSize = size_t(packet->SampleFrameCount) * Audio.GetBytesPerSampleFrame();
+	if (size != actualSize)
+		nosEngine.LogW("(Device %d) %s Audio Read: Buffer size does not match packet size", DeviceIndex, GetChannelName(Channel));
+	if (!AudioRing.Read(packet->Position, buffer, std::min(size, actualSize)))
+	{
+		nosEngine.LogE("(Device %d) %s Audio Read: Samples are overwritten before they could be read", DeviceIndex, GetChannelName(Channel));
+		return false;
+	}
+	return true;
+}
+
+std::optional<nosDeckLinkFrameInfo> InputHandler::GetLastReadFrameInfo()
+{
+	std::unique_lock lock(ReadFramesMutex);
+	return LastReadFrameInfo;
+}
+
+bool InputHandler::ReadAncillaryPackets(nosDeckLinkAncillaryPacketList& outList)
+{
+	if (!CaptureAncillaryPackets)
+	{
+		nosEngine.LogE("(Device %d) %s Ancillary Read: Ancillary packet capture is not enabled", DeviceIndex, GetChannelName(Channel));
+		return false;
+	}
+	std::unique_lock lock(ReadFramesMutex);
+	if (!LastReadAncillary)
+	{
+		nosEngine.LogE("(Device %d) %s Ancillary Read: No ancillary packets captured with the last read frame", DeviceIndex, GetChannelName(Channel));
+		return false;
+	}
+	outList = nosDeckLinkAncillaryPacketList{
+		.Packets = LastReadAncillary->Packets.data(),
+		.Count = (uint32_t)LastReadAncillary->Packets.size(),
+		.DroppedCount = LastReadAncillary->DroppedCount,
+		.FrameTime = LastReadAncillary->FrameTime,
+	};
+	return true;
+}
+
+void InputHandler::OnInputVideoFormatChanged_DeckLinkThread(BMDDisplayMode newDisplayMode, BMDPixelFormat pixelFormat, bool dualStream3DDetected)
 {
 	// Pause video capture
 	Interface->PauseStreams();
 			
 	// Enable video input with the properties of the new video stream
-	Interface->EnableVideoInput(newDisplayMode, pixelFormat, bmdVideoInputEnableFormatDetection);
+	EnableVideoInput(newDisplayMode, pixelFormat);
 
 	// Flush any queued video frames
 	Interface->FlushStreams();
 
-	// Start video capture
-	Interface->StartStreams();
-
-	auto [frameGeometry, frameRate] = GetFrameGeometryAndRatePairFromDeckLinkDisplayMode(newDisplayMode);
+	// Inputs are opened in a placeholder mode, frame timing and callback deadlines follow the detected one.
+	IDeckLinkDisplayMode* displayModeInterface = nullptr;
+	if (Interface->GetDisplayMode(newDisplayMode, &displayModeInterface) == S_OK && displayModeInterface)
 	{
-		std::unique_lock lock(CallbacksMutex);
-		for (auto& [_, pair] : VideoFormatChangeCallbacks)
+		BMDTimeValue frameDuration = 0;
+		BMDTimeScale timeScale = 0;
+		if (displayModeInterface->GetFrameRate(&frameDuration, &timeScale) == S_OK && timeScale)
 		{
-			auto& [callback, userData] = pair;
-			callback(userData, frameGeometry, frameRate, GetPixelFormatFromDeckLink(pixelFormat));
+			FrameDuration = frameDuration;
+			TimeScale = timeScale;
+			Callbacks->FrameIntervalNs = FrameDuration * 1'000'000'000 / TimeScale;
 		}
+		Release(displayModeInterface);
 	}
+
+	// Start video capture
+	Interface->StartStreams();
+
+	auto [frameGeometry, frameRate] = GetFrameGeometryAndRatePairFromDeckLinkDisplayMode(newDisplayMode);
+	CurrentFormat.Geometry = frameGeometry;
+	CurrentFormat.FrameRate = frameRate;
+	CurrentFormat.PixelFormat = GetPixelFormatFromDeckLink(pixelFormat);
+	CurrentFormat.Range = GetVideoRangeOfDeckLinkPixelFormat(pixelFormat);
+	CurrentFormat.DualStream3D = dualStream3DDetected;
+	if (dualStream3DDetected && !DualStream3D)
+		nosEngine.LogW("(Device %d) %s Input: Dual-stream 3D signal detected, only the left eye is captured", DeviceIndex, GetChannelName(Channel));
+	// Frames may carry their colorspace too, which takes over once they arrive.
+	CurrentFormat.Colorspace = GetDetectedColorspace();
+	CallbackDispatcher::Instance()->PostInputVideoFormatChanged(Callbacks, CurrentFormat, true);
+}
+
+nosDeckLinkColorspace InputHandler::GetDetectedColorspace()
+{
+	int64_t colorspace = 0;
+	if (!Status || Status->GetInt(bmdDeckLinkStatusDetectedVideoInputColorspace, &colorspace) != S_OK)
+		return NOS_DECKLINK_COLORSPACE_UNKNOWN;
+	return GetColorspaceFromDeckLink(BMDColorspace(colorspace));
 }
 
 int32_t InputHandler::AddInputVideoFormatChangeCallback(nosDeckLinkInputVideoFormatChangeCallback callback, void* userData)
 {
-	std::unique_lock lock(CallbacksMutex);
-	auto callbackId = NextCallbackId++;
-	VideoFormatChangeCallbacks[callbackId] = {callback, userData};
-	return callbackId;
+	return Callbacks->VideoFormatChange.Add(callback, userData);
 }
 
-void InputHandler::RemoveInputVideoFormatChangeCallback(int32_t callbackId)
+int32_t InputHandler::AddInputVideoFormatChangeCallbackV2(nosDeckLinkInputVideoFormatChangeCallbackV2 callback, void* userData)
 {
-	std::unique_lock lock(CallbacksMutex);
-	VideoFormatChangeCallbacks.erase(callbackId);
+	return Callbacks->VideoFormatChangeV2.Add(callback, userData);
 }
 }
@@ -4,35 +4,73 @@
 #include "Common.hpp"
 #include "nosDeckLinkSubsystem/nosDeckLinkSubsystem.h"
 #include "VideoFrame.hpp"
+#include "FrameAllocator.hpp"
+#include "AudioRingBuffer.hpp"
+#include "Ancillary.hpp"
+#include "Timecode.hpp"
 
 namespace nos::decklink
 {
 
+// Samples of an audio packet in the capture ring
+struct AudioPacket
+{
+	uint64_t Position; // Stream position in the ring
+	uint32_t SampleFrameCount;
+	BMDTimeValue PacketTime;
+	BMDTimeValue FrameTime;
+};
+
+struct InputFrame
+{
+	std::unique_ptr<VideoFrame> Video;
+	std::unique_ptr<VideoFrame> RightEye; // Dual-stream 3D only
+	std::optional<AudioPacket> Audio;
+	AncillaryArenaPool::Handle Ancillary;
+	BMDTimeValue FrameTime = 0;
+	BMDTimeValue FrameDuration = 0;
+	FrameTimecodes Timecodes{};
+};
+
 struct InputHandler : IOHandlerBase<IDeckLinkInput>
 {
 	~InputHandler() override;
 
+	// Declared before the frames, arenas must outlive them.
+	AncillaryArenaPool AncillaryArenas;
+
 	std::condition_variable FrameAvailableCond;
-	std::deque<std::unique_ptr<VideoFrame>> ReadFrames;
+	std::deque<InputFrame> ReadFrames;
+	// Of the frame last read by DmaTransfer, guarded by ReadFramesMutex
+	std::optional<AudioPacket> LastReadAudio;
+	AncillaryArenaPool::Handle LastReadAncillary = {nullptr, {&AncillaryArenas}};
+	std::optional<nosDeckLinkFrameInfo> LastReadFrameInfo;
 	std::mutex ReadFramesMutex;
+	FrameAllocatorProvider* AllocatorProvider = nullptr;
+	IDeckLinkStatus* Status = nullptr; // May be null
+	AudioRingBuffer AudioRing;
+	nosDeckLinkInputVideoFormat CurrentFormat{}; // Updated on the DeckLink thread, after open
+	bool DualStream3D = false;
 
 	bool Flush();
 	bool WaitFrame(std::chrono::milliseconds timeout) override;
-	void DmaTransfer(void* buffer, size_t size) override;
+	bool DmaTransfer(void* buffer, size_t size) override;
+	std::pair<size_t, int32_t> GetFrameMemoryPlacement() override;
+	bool ReadAudio(void* buffer, size_t size, nosDeckLinkAudioPacketInfo& outInfo);
+	bool ReadAncillaryPackets(nosDeckLinkAncillaryPacketList& outList);
+	std::optional<nosDeckLinkFrameInfo> GetLastReadFrameInfo();
 
-	void OnInputFrameArrived_DeckLinkThread(IDeckLinkVideoInputFrame* frame);
-	void OnInputVideoFormatChanged_DeckLinkThread(BMDDisplayMode newDisplayMode, BMDPixelFormat pixelFormat);
+	void OnInputFrameArrived_DeckLinkThread(IDeckLinkVideoInputFrame* frame, IDeckLinkAudioInputPacket* audioPacket);
+	void OnInputVideoFormatChanged_DeckLinkThread(BMDDisplayMode newDisplayMode, BMDPixelFormat pixelFormat, bool dualStream3DDetected);
 
 	int32_t AddInputVideoFormatChangeCallback(nosDeckLinkInputVideoFormatChangeCallback callback, void* userData);
-	void RemoveInputVideoFormatChangeCallback(int32_t callbackId);
-	
-	std::mutex CallbacksMutex;
-	std::unordered_map<int32_t, std::pair<nosDeckLinkInputVideoFormatChangeCallback, void*>> VideoFormatChangeCallbacks;
-	int32_t NextCallbackId = 0;
-
-	
+	int32_t AddInputVideoFormatChangeCallbackV2(nosDeckLinkInputVideoFormatChangeCallbackV2 callback, void* userData);
 	
 protected:
+	HRESULT EnableVideoInput(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat);
+	// Called with ReadFramesMutex held.
+	void UpdateQueuedFrameMemory();
+	nosDeckLinkColorspace GetDetectedColorspace();
 	bool Open(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat) override;
 	bool Start() override;
 	bool Stop() override;
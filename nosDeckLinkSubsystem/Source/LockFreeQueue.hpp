@@ -0,0 +1,91 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace nos::decklink
+{
+
+/// Bounded multi-producer/multi-consumer queue (D. Vyukov). Push and pop never block and never allocate,
+/// so it is safe to use from DeckLink callback threads. Capacity must be a power of two.
+template <typename T>
+class LockFreeQueue
+{
+public:
+	explicit LockFreeQueue(size_t capacity)
+		: Mask(capacity - 1), Cells(new Cell[capacity])
+	{
+		for (size_t i = 0; i < capacity; ++i)
+			Cells[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+
+	LockFreeQueue(const LockFreeQueue&) = delete;
+	LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+	bool TryPush(T&& value)
+	{
+		size_t pos = EnqueuePos.load(std::memory_order_relaxed);
+		Cell* cell;
+		for (;;)
+		{
+			cell = &Cells[pos & Mask];
+			size_t seq = cell->Sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+			if (diff == 0)
+			{
+				if (EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+				return false; // Full
+			else
+				pos = EnqueuePos.load(std::memory_order_relaxed);
+		}
+		cell->Value = std::move(value);
+		cell->Sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool TryPop(T& out)
+	{
+		size_t pos = DequeuePos.load(std::memory_order_relaxed);
+		Cell* cell;
+		for (;;)
+		{
+			cell = &Cells[pos & Mask];
+			size_t seq = cell->Sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+			if (diff == 0)
+			{
+				if (DequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+				return false; // Empty
+			else
+				pos = DequeuePos.load(std::memory_order_relaxed);
+		}
+		out = std::move(cell->Value);
+		cell->Sequence.store(pos + Mask + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t Capacity() const { return Mask + 1; }
+
+protected:
+	struct Cell
+	{
+		std::atomic_size_t Sequence;
+		T Value{};
+	};
+
+	const size_t Mask;
+	std::unique_ptr<Cell[]> Cells;
+	alignas(64) std::atomic_size_t EnqueuePos = 0;
+	alignas(64) std::atomic_size_t DequeuePos = 0;
+};
+
+}
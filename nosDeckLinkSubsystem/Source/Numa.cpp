@@ -0,0 +1,271 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#include "Numa.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <regex>
+#include <unordered_map>
+
+#if _WIN32
+#include <Windows.h>
+#include <SetupAPI.h>
+#include <cfgmgr32.h>
+#include <initguid.h>
+#include <devpkey.h>
+#include <cctype>
+#include <cstdio>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#endif
+
+namespace nos::decklink
+{
+
+#if _WIN32
+
+static std::string NormalizeDeviceId(std::string id)
+{
+	// Handles can be device interface paths (\\?\PCI#VEN_...#...#{guid}), instance IDs separate the same parts with backslashes.
+	for (auto& c : id)
+		c = c == '#' ? '\\' : (char)std::toupper((unsigned char)c);
+	return id;
+}
+
+/// Calls fn with the present PCI device whose instance ID is part of the handle.
+template <typename Fn>
+static bool WithPciDeviceOfHandle(std::string const& deviceHandle, Fn&& fn)
+{
+	auto handle = NormalizeDeviceId(deviceHandle);
+	HDEVINFO devices = SetupDiGetClassDevsA(nullptr, "PCI", nullptr, DIGCF_ALLCLASSES | DIGCF_PRESENT);
+	if (devices == INVALID_HANDLE_VALUE)
+		return false;
+	bool found = false;
+	SP_DEVINFO_DATA info{};
+	info.cbSize = sizeof(info);
+	for (DWORD i = 0; !found && SetupDiEnumDeviceInfo(devices, i, &info); ++i)
+	{
+		char instanceId[MAX_DEVICE_ID_LEN]{};
+		if (!SetupDiGetDeviceInstanceIdA(devices, &info, instanceId, sizeof(instanceId), nullptr))
+			continue;
+		if (handle.find(NormalizeDeviceId(instanceId)) == std::string::npos)
+			continue;
+		found = true;
+		fn(devices, info);
+	}
+	SetupDiDestroyDeviceInfoList(devices);
+	return found;
+}
+
+static std::optional<uint32_t> GetUInt32Property(HDEVINFO devices, SP_DEVINFO_DATA& info, DEVPROPKEY const& key)
+{
+	DEVPROPTYPE type = DEVPROP_TYPE_EMPTY;
+	uint32_t value = 0;
+	if (!SetupDiGetDevicePropertyW(devices, &info, &key, &type, (PBYTE)&value, sizeof(value), nullptr, 0) || type != DEVPROP_TYPE_UINT32)
+		return std::nullopt;
+	return value;
+}
+
+std::optional<std::string> GetPciAddressOfDeviceHandle(std::string const& deviceHandle)
+{
+	std::optional<std::string> address;
+	WithPciDeviceOfHandle(deviceHandle, [&address](HDEVINFO devices, SP_DEVINFO_DATA& info) {
+		auto bus = GetUInt32Property(devices, info, DEVPKEY_Device_BusNumber);
+		auto deviceAndFunction = GetUInt32Property(devices, info, DEVPKEY_Device_Address); // (device << 16) | function on PCI
+		if (!bus || !deviceAndFunction)
+			return;
+		// Segment is not exposed as a device property, it is 0 on all but very large systems.
+		char buffer[16];
+		std::snprintf(buffer, sizeof(buffer), "0000:%02x:%02x.%x", *bus & 0xff, (*deviceAndFunction >> 16) & 0x1f, *deviceAndFunction & 0x7);
+		address = buffer;
+	});
+	return address;
+}
+
+int32_t GetNumaNodeOfDeviceHandle(std::string const& deviceHandle)
+{
+	int32_t numaNode = -1;
+	WithPciDeviceOfHandle(deviceHandle, [&numaNode](HDEVINFO devices, SP_DEVINFO_DATA& info) {
+		// Not set on systems with a single node.
+		if (auto node = GetUInt32Property(devices, info, DEVPKEY_Device_Numa_Node))
+			numaNode = int32_t(*node);
+	});
+	return numaNode;
+}
+
+static bool SetThreadNumaAffinity(HANDLE thread, int32_t numaNode)
+{
+	if (numaNode < 0)
+		return false;
+	GROUP_AFFINITY affinity{};
+	if (!GetNumaNodeProcessorMaskEx((USHORT)numaNode, &affinity))
+		return false;
+	return SetThreadGroupAffinity(thread, &affinity, nullptr);
+}
+
+bool SetThreadNumaAffinity(std::thread& thread, int32_t numaNode)
+{
+	return SetThreadNumaAffinity((HANDLE)thread.native_handle(), numaNode);
+}
+
+bool SetCurrentThreadNumaAffinity(int32_t numaNode)
+{
+	return SetThreadNumaAffinity(GetCurrentThread(), numaNode);
+}
+
+ScopedThreadNumaAffinity::ScopedThreadNumaAffinity(int32_t numaNode)
+{
+	static_assert(sizeof(PreviousAffinity) >= sizeof(GROUP_AFFINITY));
+	if (numaNode < 0)
+		return;
+	GROUP_AFFINITY affinity{};
+	if (!GetNumaNodeProcessorMaskEx((USHORT)numaNode, &affinity))
+		return;
+	Pinned = SetThreadGroupAffinity(GetCurrentThread(), &affinity, reinterpret_cast<GROUP_AFFINITY*>(PreviousAffinity));
+}
+
+ScopedThreadNumaAffinity::~ScopedThreadNumaAffinity()
+{
+	if (Pinned)
+		SetThreadGroupAffinity(GetCurrentThread(), reinterpret_cast<GROUP_AFFINITY*>(PreviousAffinity), nullptr);
+}
+
+#else
+
+static std::optional<std::string> FindPciAddress(std::string const& text)
+{
+	static const std::regex pciAddress(R"(([0-9a-fA-F]{4}:)?[0-9a-fA-F]{2}:[0-9a-fA-F]{2}\.[0-7])");
+	std::smatch match;
+	if (!std::regex_search(text, match, pciAddress))
+		return std::nullopt;
+	std::string address = match.str();
+	if (!match[1].matched)
+		address = "0000:" + address;
+	return address;
+}
+
+static std::optional<std::filesystem::path> GetSysfsDevicePath(std::string const& deviceHandle)
+{
+	if (auto address = FindPciAddress(deviceHandle))
+		return std::filesystem::path("/sys/bus/pci/devices") / *address;
+	// Handle can also be the character device of the card, sysfs links it to its PCI device.
+	struct stat st{};
+	if (stat(deviceHandle.c_str(), &st) != 0 || !S_ISCHR(st.st_mode))
+		return std::nullopt;
+	return std::filesystem::path("/sys/dev/char") / (std::to_string(major(st.st_rdev)) + ":" + std::to_string(minor(st.st_rdev))) / "device";
+}
+
+std::optional<std::string> GetPciAddressOfDeviceHandle(std::string const& deviceHandle)
+{
+	if (auto address = FindPciAddress(deviceHandle))
+		return address;
+	auto devicePath = GetSysfsDevicePath(deviceHandle);
+	if (!devicePath)
+		return std::nullopt;
+	std::error_code ec;
+	auto resolved = std::filesystem::canonical(*devicePath, ec);
+	if (ec)
+		return std::nullopt;
+	return FindPciAddress(resolved.filename().string());
+}
+
+int32_t GetNumaNodeOfDeviceHandle(std::string const& deviceHandle)
+{
+	auto devicePath = GetSysfsDevicePath(deviceHandle);
+	if (!devicePath)
+		return -1;
+	std::ifstream file(*devicePath / "numa_node");
+	int32_t numaNode = -1;
+	if (!(file >> numaNode))
+		return -1;
+	return numaNode;
+}
+
+static bool GetCpusOfNumaNode(int32_t numaNode, cpu_set_t& outCpus)
+{
+	CPU_ZERO(&outCpus);
+	if (numaNode < 0)
+		return false;
+	std::ifstream file("/sys/devices/system/node/node" + std::to_string(numaNode) + "/cpulist");
+	std::string cpuList;
+	if (!std::getline(file, cpuList))
+		return false;
+	// Format: 0-15,32-47
+	bool any = false;
+	size_t pos = 0;
+	while (pos < cpuList.size())
+	{
+		auto end = cpuList.find(',', pos);
+		if (end == std::string::npos)
+			end = cpuList.size();
+		auto range = cpuList.substr(pos, end - pos);
+		pos = end + 1;
+		if (range.empty())
+			continue;
+		auto dash = range.find('-');
+		int first = std::stoi(range.substr(0, dash));
+		int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+		for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+		{
+			CPU_SET(cpu, &outCpus);
+			any = true;
+		}
+	}
+	return any;
+}
+
+static bool SetThreadNumaAffinity(pthread_t thread, int32_t numaNode)
+{
+	cpu_set_t cpus;
+	if (!GetCpusOfNumaNode(numaNode, cpus))
+		return false;
+	return pthread_setaffinity_np(thread, sizeof(cpus), &cpus) == 0;
+}
+
+bool SetThreadNumaAffinity(std::thread& thread, int32_t numaNode)
+{
+	return SetThreadNumaAffinity(thread.native_handle(), numaNode);
+}
+
+bool SetCurrentThreadNumaAffinity(int32_t numaNode)
+{
+	return SetThreadNumaAffinity(pthread_self(), numaNode);
+}
+
+ScopedThreadNumaAffinity::ScopedThreadNumaAffinity(int32_t numaNode)
+{
+	static_assert(sizeof(PreviousAffinity) >= sizeof(cpu_set_t));
+	// Read once per node, this runs on every transfer.
+	static std::mutex cacheMutex;
+	static std::unordered_map<int32_t, std::optional<cpu_set_t>> cpusOfNode;
+	std::optional<cpu_set_t> cpus;
+	{
+		std::unique_lock lock(cacheMutex);
+		auto it = cpusOfNode.find(numaNode);
+		if (it == cpusOfNode.end())
+		{
+			cpu_set_t nodeCpus;
+			it = cpusOfNode.emplace(numaNode, GetCpusOfNumaNode(numaNode, nodeCpus) ? std::optional(nodeCpus) : std::nullopt).first;
+		}
+		cpus = it->second;
+	}
+	if (!cpus)
+		return;
+	auto& previous = *reinterpret_cast<cpu_set_t*>(PreviousAffinity);
+	if (pthread_getaffinity_np(pthread_self(), sizeof(previous), &previous) != 0)
+		return;
+	Pinned = pthread_setaffinity_np(pthread_self(), sizeof(*cpus), &*cpus) == 0;
+}
+
+ScopedThreadNumaAffinity::~ScopedThreadNumaAffinity()
+{
+	if (Pinned)
+		pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), reinterpret_cast<cpu_set_t*>(PreviousAffinity));
+}
+
+#endif
+
+}
@@ -0,0 +1,39 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace nos::decklink
+{
+
+/// PCI address (domain:bus:device.function) of the card behind a DeckLink device handle, if it can be resolved.
+std::optional<std::string> GetPciAddressOfDeviceHandle(std::string const& deviceHandle);
+/// NUMA node the card behind a DeckLink device handle is attached to, -1 if unknown or if the system is not NUMA.
+int32_t GetNumaNodeOfDeviceHandle(std::string const& deviceHandle);
+
+/// Restricts a thread to the cores of a NUMA node.
+bool SetThreadNumaAffinity(std::thread& thread, int32_t numaNode);
+bool SetCurrentThreadNumaAffinity(int32_t numaNode);
+
+/// Restricts the calling thread to the cores of a NUMA node while in scope, then restores the affinity it had before.
+/// For threads the subsystem does not own.
+class ScopedThreadNumaAffinity
+{
+public:
+	explicit ScopedThreadNumaAffinity(int32_t numaNode);
+	~ScopedThreadNumaAffinity();
+	ScopedThreadNumaAffinity(ScopedThreadNumaAffinity const&) = delete;
+	ScopedThreadNumaAffinity& operator=(ScopedThreadNumaAffinity const&) = delete;
+
+	bool IsPinned() const { return Pinned; }
+
+private:
+	bool Pinned = false;
+	// GROUP_AFFINITY on Windows, cpu_set_t otherwise
+	alignas(8) unsigned char PreviousAffinity[128]{};
+};
+
+}
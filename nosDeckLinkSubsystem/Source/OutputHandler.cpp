@@ -5,6 +5,7 @@
 #include <nosUtil/Stopwatch.hpp>
 
 #include "EnumConversions.hpp"
+#include "FillKey.hpp"
 #include "VideoFrame.hpp"
 
 namespace nos::decklink
@@ -46,57 +47,165 @@ HRESULT	OutputCallback::ScheduledPlaybackHasStopped(void)
 OutputHandler::~OutputHandler()
 {
 	CloseStream();
+	Release(BufferPool);
+	Release(Keyer);
 	Release(Interface);
 }
 
-bool OutputHandler::Open(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat)
+std::optional<OutputHandler::FrameLayout> OutputHandler::GetFrameLayout(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat)
 {
-	if (pixelFormat == bmdFormatUnspecified)
-		return false;
-	HRESULT res;
+	IDeckLinkDisplayMode* displayModeInterface = nullptr;
+	if (Interface->GetDisplayMode(displayMode, &displayModeInterface) != S_OK || !displayModeInterface)
+		return std::nullopt;
+	FrameLayout layout{.Width = displayModeInterface->GetWidth(), .Height = displayModeInterface->GetHeight(), .PixelFormat = pixelFormat};
+	auto res = displayModeInterface->GetFrameRate(&layout.FrameDuration, &layout.TimeScale);
+	Release(displayModeInterface);
+	if (res != S_OK)
+		return std::nullopt;
+	if (Interface->RowBytesForPixelFormat(pixelFormat, layout.Width, &layout.RowBytes) != S_OK)
+		return std::nullopt;
+	return layout;
+}
+
+bool OutputHandler::HasFramesOfLayout(FrameLayout const& layout) const
+{
+	for (auto* frame : VideoFrames)
+		if (!frame || frame->GetWidth() != layout.Width || frame->GetHeight() != layout.Height || frame->GetRowBytes() != layout.RowBytes || frame->GetPixelFormat() != layout.PixelFormat)
+			return false;
+	return true;
+}
+
+bool OutputHandler::CreateFrames(FrameLayout const& layout)
+{
+	for (auto& frame : VideoFrames)
+		Release(frame);
+	WriteQueue.clear();
+	Memory->Set(NOS_DECKLINK_MEMORY_PURPOSE_OUTPUT_FRAMES, 0);
+	// Buffers of the pool are kept if they fit the new frames, e.g. when only the pixel format changes between formats of the same size.
+	if (BufferPool && BufferPool->BufferSize != size_t(layout.RowBytes) * layout.Height)
+		Release(BufferPool);
 	{
-		std::unique_lock lock(VideoFramesMutex);
-		for (auto& frame : VideoFrames)
-			Release(frame);
-		for (auto& frame : VideoFrames)
+		std::unique_lock hdrLock(HDRMetadataMutex);
+		FrameHDRMetadataVersions = {};
+	}
+	for (auto& frame : VideoFrames)
+	{
+		if (FrameMemory.UseFrameAllocator())
 		{
-			// Get width and height from display mode
-			long width, height;
-			int rowBytes;
+			if (!BufferPool)
+				BufferPool = new FrameBufferPool(size_t(layout.RowBytes) * layout.Height, FrameMemory, {DeviceIndex, Channel}, Memory);
+			IDeckLinkVideoBuffer* buffer = nullptr;
+			if (BufferPool->AllocateVideoBuffer(&buffer) == S_OK)
 			{
-				IDeckLinkDisplayMode* displayModeInterface = nullptr;
-				res = Interface->GetDisplayMode(displayMode, &displayModeInterface);
-				if (res != S_OK)
-					return false;
-				width = displayModeInterface->GetWidth();
-				height = displayModeInterface->GetHeight();
-				res = displayModeInterface->GetFrameRate(&FrameDuration, &TimeScale);
-				if (res != S_OK)
-					return false;
-				rowBytes = 0;
-				res = Interface->RowBytesForPixelFormat(pixelFormat, width, &rowBytes);
-				if (res != S_OK)
-					return false;
-				Release(displayModeInterface);
+				Interface->CreateVideoFrameWithBuffer(layout.Width, layout.Height, layout.RowBytes, layout.PixelFormat, bmdFrameFlagDefault, buffer, &frame);
+				Release(buffer);
 			}
-			Interface->CreateVideoFrame(width, height, rowBytes, pixelFormat, bmdFrameFlagDefault, &frame);
-			if (!frame)
+			// Falling back would bypass the quota and the memory limit of the shared pool.
+			if (!frame && FrameMemory.SharedPool)
 				return false;
-			WriteQueue.push_back(frame);
+			if (!frame)
+				nosEngine.LogW("(Device %d) %s Output: Failed to create frame with own buffer, falling back to SDK allocation", DeviceIndex, GetChannelName(Channel));
 		}
+		if (!frame)
+			Interface->CreateVideoFrame(layout.Width, layout.Height, layout.RowBytes, layout.PixelFormat, bmdFrameFlagDefault, &frame);
+		if (!frame)
+			return false;
+		Memory->Add(NOS_DECKLINK_MEMORY_PURPOSE_OUTPUT_FRAMES, int64_t(frame->GetRowBytes()) * frame->GetHeight());
+		WriteQueue.push_back(frame);
 	}
+	return true;
+}
 
-	res = Interface->EnableVideoOutput(displayMode, bmdVideoOutputFlagDefault);
+bool OutputHandler::EnableOutput(BMDDisplayMode displayMode)
+{
+	BMDVideoOutputFlags outputFlags = bmdVideoOutputFlagDefault;
+	if (TimecodeMode != NOS_DECKLINK_OUTPUT_TIMECODE_MODE_NONE)
+	{
+		bool vitc = TimecodeFormat == NOS_DECKLINK_TIMECODE_FORMAT_VITC || TimecodeFormat == NOS_DECKLINK_TIMECODE_FORMAT_VITC_FIELD2;
+		outputFlags = BMDVideoOutputFlags(outputFlags | (vitc ? bmdVideoOutputVITC : bmdVideoOutputRP188));
+	}
+	auto res = Interface->EnableVideoOutput(displayMode, outputFlags);
 	if (res != S_OK)
 		return false;
 
+	if (UsesHardwareKeyer())
+	{
+		res = Keyer ? Keyer->Enable(KeyerMode == NOS_DECKLINK_KEYER_MODE_EXTERNAL) : E_NOINTERFACE;
+		if (res == S_OK)
+			res = Keyer->SetLevel(255);
+		if (res != S_OK)
+		{
+			nosEngine.LogE("(Device %d) %s Output: Could not enable keyer - result = %08x", DeviceIndex, GetChannelName(Channel), res);
+			Interface->DisableVideoOutput();
+			return false;
+		}
+	}
+
+	if (Audio.IsEnabled())
+	{
+		res = Interface->EnableAudioOutput(bmdAudioSampleRate48kHz, Audio.SampleType, Audio.ChannelCount, bmdAudioOutputStreamTimestamped);
+		if (res != S_OK)
+		{
+			nosEngine.LogE("(Device %d) %s Output: Could not enable audio output with %u channels - result = %08x", DeviceIndex, GetChannelName(Channel), Audio.ChannelCount, res);
+			if (UsesHardwareKeyer())
+				Keyer->Disable();
+			Interface->DisableVideoOutput();
+			return false;
+		}
+		std::unique_lock lock(AudioMutex);
+		// Frames alternate between two sample counts at most, e.g. 1601 and 1602 at 29.97.
+		size_t maxSampleFrames = (FrameDuration * bmdAudioSampleRate48kHz + TimeScale - 1) / TimeScale;
+		AudioBlock.assign(maxSampleFrames * Audio.GetBytesPerSampleFrame(), 0);
+		AudioBlockSize = 0;
+		Memory->Set(NOS_DECKLINK_MEMORY_PURPOSE_AUDIO, AudioBlock.capacity());
+	}
+	return true;
+}
+
+void OutputHandler::DisableOutput()
+{
+	if (UsesHardwareKeyer())
+		Keyer->Disable();
+	if (Audio.IsEnabled())
+		Interface->DisableAudioOutput();
+	Interface->DisableVideoOutput();
+}
+
+bool OutputHandler::Open(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat)
+{
+	if (pixelFormat == bmdFormatUnspecified)
+		return false;
+	auto layout = GetFrameLayout(displayMode, pixelFormat);
+	if (!layout)
+		return false;
+	{
+		std::unique_lock lock(VideoFramesMutex);
+		// Frame memory policy may have changed since the last open.
+		Release(BufferPool);
+		FrameDuration = layout->FrameDuration;
+		TimeScale = layout->TimeScale;
+		if (!CreateFrames(*layout))
+			return false;
+	}
+
+	if (TimecodeMode != NOS_DECKLINK_OUTPUT_TIMECODE_MODE_NONE)
+	{
+		std::unique_lock lock(TimecodeMutex);
+		Timecode = nosDeckLinkTimecode{.Valid = true};
+		TimecodeStartFrame = 0;
+	}
+	if (!EnableOutput(displayMode))
+		return false;
+	DisplayMode = displayMode;
+	PixelFormat = pixelFormat;
+
 	auto outputCallback = new OutputCallback(this);
 	if (outputCallback == nullptr)
 	{
 		nosEngine.LogE("Could not create output callback");
 		return false;
 	}
-	res = Interface->SetScheduledFrameCompletionCallback(outputCallback);
+	auto res = Interface->SetScheduledFrameCompletionCallback(outputCallback);
 	Release(outputCallback);
 	if (res != S_OK)
 	{
@@ -111,7 +220,108 @@ bool OutputHandler::Open(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat)
 	return true;
 }
 
-bool OutputHandler::Start()
+bool OutputHandler::Reconfigure(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat)
+{
+	if (!IsCurrentlyOpen() || IsCurrentlyRunning() || pixelFormat == bmdFormatUnspecified)
+		return false;
+	auto layout = GetFrameLayout(displayMode, pixelFormat);
+	if (!layout)
+		return false;
+	if (displayMode == DisplayMode && HasFramesOfLayout(*layout))
+		return true;
+	auto previousDisplayMode = DisplayMode;
+	auto previousLayout = GetFrameLayout(DisplayMode, PixelFormat);
+	if (ApplyFormat(displayMode, *layout))
+		return true;
+	nosEngine.LogE("(Device %d) %s Output: Failed to reconfigure, restoring the previous format", DeviceIndex, GetChannelName(Channel));
+	if (!previousLayout || !ApplyFormat(previousDisplayMode, *previousLayout))
+		nosEngine.LogE("(Device %d) %s Output: Failed to restore the previous format, channel should be reopened", DeviceIndex, GetChannelName(Channel));
+	return false;
+}
+
+bool OutputHandler::ApplyFormat(BMDDisplayMode displayMode, FrameLayout const& layout)
+{
+	// The output callback, callbacks of the channel and frames are kept. Frames are only recreated if their layout changes.
+	DisableOutput();
+	Prerolled = false;
+	{
+		std::unique_lock lock(VideoFramesMutex);
+		FrameDuration = layout.FrameDuration;
+		TimeScale = layout.TimeScale;
+		if (HasFramesOfLayout(layout))
+		{
+			WriteQueue.clear();
+			for (auto& frame : VideoFrames)
+				WriteQueue.push_back(frame);
+		}
+		else if (!CreateFrames(layout))
+			return false;
+	}
+	if (!EnableOutput(displayMode))
+		return false;
+	DisplayMode = displayMode;
+	PixelFormat = layout.PixelFormat;
+	Callbacks->FrameIntervalNs = TimeScale ? FrameDuration * 1'000'000'000 / TimeScale : 0;
+	return true;
+}
+
+bool OutputHandler::Preroll()
+{
+	if (!IsCurrentlyOpen() || IsCurrentlyRunning())
+		return false;
+	if (Prerolled)
+		return true;
+	ResetScheduling();
+	std::vector<IDeckLinkVideoFrame*> frames;
+	{
+		std::unique_lock lock(VideoFramesMutex);
+		frames.assign(WriteQueue.begin(), WriteQueue.end());
+		WriteQueue.clear();
+	}
+	// Frames are written once here, so SDK allocated buffers are faulted in before the take as well.
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		auto* frame = frames[i];
+		FillBlack(frame);
+		auto frameIt = std::find(VideoFrames.begin(), VideoFrames.end(), frame);
+		if (frameIt != VideoFrames.end())
+		{
+			if (TimecodeMode != NOS_DECKLINK_OUTPUT_TIMECODE_MODE_NONE)
+				SetTimecodeOfFrame(*frameIt, TotalFramesScheduled);
+			UpdateHDRMetadataOfFrame(frameIt - VideoFrames.begin());
+		}
+		if (Interface->ScheduleVideoFrame(frame, TotalFramesScheduled * FrameDuration, FrameDuration, TimeScale) != S_OK)
+		{
+			nosEngine.LogE("(Device %d) %s Output: Failed to schedule preroll frame", DeviceIndex, GetChannelName(Channel));
+			// Frames before this one are held by the driver, they must not be scheduled again by the next start.
+			DropScheduledFrames();
+			return false;
+		}
+		if (Audio.IsEnabled())
+			ScheduleAudioOfFrame(TotalFramesScheduled);
+		++TotalFramesScheduled;
+	}
+	Prerolled = true;
+	return true;
+}
+
+void OutputHandler::CancelPreroll()
+{
+	if (!Prerolled.exchange(false))
+		return;
+	DropScheduledFrames();
+}
+
+void OutputHandler::DropScheduledFrames()
+{
+	// Disabling the output drops the frames and audio the driver has scheduled, playback would otherwise start with them.
+	DisableOutput();
+	if (!EnableOutput(DisplayMode))
+		nosEngine.LogE("(Device %d) %s Output: Failed to enable output again after dropping scheduled frames, channel should be reopened", DeviceIndex, GetChannelName(Channel));
+	ResetScheduling();
+}
+
+void OutputHandler::ResetScheduling()
 {
 	{
 		std::unique_lock lock(VideoFramesMutex);
@@ -121,6 +331,32 @@ bool OutputHandler::Start()
 		for (auto& frame : VideoFrames)
 			WriteQueue.push_back(frame);
 	}
+	{
+		std::unique_lock lock(AudioMutex);
+		AudioBlockSize = 0;
+		MinBufferedAudioSampleFrames = UINT32_MAX;
+		MaxBufferedAudioSampleFrames = 0;
+		SilentAudioSampleFramesInserted = 0;
+	}
+	{
+		std::unique_lock lock(TimecodeMutex);
+		TimecodeStartFrame = 0;
+	}
+}
+
+std::optional<OutputHandler::ReferenceClockPosition> OutputHandler::GetReferenceClockPosition()
+{
+	BMDTimeValue hardwareTime = 0, timeInFrame = 0, ticksPerFrame = 0;
+	if (!IsCurrentlyOpen() || Interface->GetHardwareReferenceClock(TimeScale, &hardwareTime, &timeInFrame, &ticksPerFrame) != S_OK || ticksPerFrame <= 0)
+		return std::nullopt;
+	return ReferenceClockPosition{.Frame = hardwareTime / ticksPerFrame, .TimeInFrame = timeInFrame, .TicksPerFrame = ticksPerFrame, .TimeScale = TimeScale};
+}
+
+bool OutputHandler::Start()
+{
+	// Prerolled frames are already scheduled from stream time 0.
+	if (!Prerolled.exchange(false))
+		ResetScheduling();
 	auto res = Interface->StartScheduledPlayback(0, TimeScale, 1.0);
 	if (res != S_OK)
 	{
@@ -142,6 +378,11 @@ bool OutputHandler::Stop()
 
 bool OutputHandler::Close()
 {
+	Prerolled = false;
+	if (UsesHardwareKeyer())
+		Keyer->Disable();
+	if (Audio.IsEnabled())
+		Interface->DisableAudioOutput();
 	auto res = Interface->DisableVideoOutput();
 	if (res != S_OK)
 	{
@@ -152,7 +393,15 @@ bool OutputHandler::Close()
 		std::unique_lock lock(VideoFramesMutex);
 		for (auto& frame : VideoFrames)
 			Release(frame);
+		Release(BufferPool);
 		WriteQueue.clear();
+		Memory->Set(NOS_DECKLINK_MEMORY_PURPOSE_OUTPUT_FRAMES, 0);
+	}
+	{
+		std::unique_lock lock(AudioMutex);
+		AudioBlock = {};
+		AudioBlockSize = 0;
+		Memory->Set(NOS_DECKLINK_MEMORY_PURPOSE_AUDIO, 0);
 	}
 	{
 		std::unique_lock lock(PlaybackStoppedMutex);
@@ -167,6 +416,14 @@ bool OutputHandler::Close()
 	return true;
 }
 
+std::pair<size_t, int32_t> OutputHandler::GetFrameMemoryPlacement()
+{
+	std::unique_lock lock(VideoFramesMutex);
+	if (!BufferPool)
+		return {0, -1};
+	return BufferPool->GetPlacement();
+}
+
 bool OutputHandler::WaitFrame(std::chrono::milliseconds timeout)
 {
 	util::Stopwatch sw;
@@ -189,7 +446,7 @@ bool OutputHandler::WaitFrame(std::chrono::milliseconds timeout)
 	return res;
 }
 
-void OutputHandler::DmaTransfer(void* buffer, size_t size)
+bool OutputHandler::DmaTransfer(void* buffer, size_t size)
 {
 	util::Stopwatch sw;
 	IDeckLinkVideoFrame* frame;
@@ -198,10 +455,22 @@ void OutputHandler::DmaTransfer(void* buffer, size_t size)
 		if (WriteQueue.empty())
 		{
 			nosEngine.LogE("(Device %d) %s DMA Write: No frame available to write", DeviceIndex, GetChannelName(Channel));
-			return;
+			return false;
 		}
 		frame = WriteQueue.front();
 	}
+	IDeckLinkVideoFrame* keyFrame = nullptr;
+	if (KeyOutput)
+	{
+		std::unique_lock lock(KeyOutput->VideoFramesMutex);
+		// Fill and key are scheduled in pairs, writing one without the other would put them a frame apart for the rest of the stream.
+		if (KeyOutput->WriteQueue.empty())
+		{
+			nosEngine.LogE("(Device %d) %s DMA Write: No key frame available to write", DeviceIndex, GetChannelName(Channel));
+			return false;
+		}
+		keyFrame = KeyOutput->WriteQueue.front();
+	}
 	{
 		VideoFrame output(frame);
 		output.StartAccess(bmdBufferAccessWrite);
@@ -214,7 +483,22 @@ void OutputHandler::DmaTransfer(void* buffer, size_t size)
 				nosEngine.LogW("(Device %d) %s DMA Write: Buffer size does not match frame size", DeviceIndex, GetChannelName(Channel));
 			}
 			size_t copySize = std::min(size, actualBufferSize);
-			std::memcpy(videoBufferBytes, buffer, copySize);
+			bool srcIsRGBA = KeyerMode != NOS_DECKLINK_KEYER_MODE_NONE && KeyerSourceFormat == NOS_DECKLINK_KEYER_SOURCE_FORMAT_RGBA;
+			std::optional<VideoFrame> key;
+			if (keyFrame)
+			{
+				key.emplace(keyFrame);
+				key->StartAccess(bmdBufferAccessWrite);
+			}
+			// Keyed frames are 8-bit with alpha, rows are tightly packed.
+			if (void* keyBytes = key ? key->GetBytes() : nullptr)
+				SplitFillAndKey(buffer, videoBufferBytes, keyBytes, copySize / 4, srcIsRGBA);
+			else if (srcIsRGBA)
+				SwapRedBlue(buffer, videoBufferBytes, copySize / 4);
+			else
+				std::memcpy(videoBufferBytes, buffer, copySize);
+			if (key)
+				key->EndAccess();
 		}
 		output.EndAccess();
 	}
@@ -222,6 +506,9 @@ void OutputHandler::DmaTransfer(void* buffer, size_t size)
 	snprintf(watchLogBuf, sizeof(watchLogBuf), "DeckLink %d:%s DMAWrite", DeviceIndex, GetChannelName(Channel));
 	nosEngine.WatchLog(watchLogBuf, sw.ElapsedString().c_str());
 	ScheduleNextFrame();
+	if (keyFrame)
+		KeyOutput->ScheduleNextFrame();
+	return true;
 }
 
 void OutputHandler::ScheduleNextFrame()
@@ -240,11 +527,174 @@ void OutputHandler::ScheduleNextFrame()
 		WriteQueue.pop_front();
 	}
 
+	// Queued frames are the ones created at open, look it up instead of querying an interface for every frame.
+	auto frameIt = std::find(VideoFrames.begin(), VideoFrames.end(), frame);
+	if (frameIt != VideoFrames.end())
+	{
+		if (TimecodeMode != NOS_DECKLINK_OUTPUT_TIMECODE_MODE_NONE)
+			SetTimecodeOfFrame(*frameIt, TotalFramesScheduled);
+		UpdateHDRMetadataOfFrame(frameIt - VideoFrames.begin());
+	}
 	HRESULT result = Interface->ScheduleVideoFrame(frame, TotalFramesScheduled * FrameDuration, FrameDuration, TimeScale);
 	if (result != S_OK)
+	{
 		nosEngine.LogE("(Device %d) %s DMA Write: Failed to schedule next frame", DeviceIndex, GetChannelName(Channel));
-	else
-		++TotalFramesScheduled;
+		return;
+	}
+	if (Audio.IsEnabled())
+		ScheduleAudioOfFrame(TotalFramesScheduled);
+	++TotalFramesScheduled;
+}
+
+void OutputHandler::SetTimecodeOfFrame(IDeckLinkMutableVideoFrame* frame, uint64_t frameNumber)
+{
+	nosDeckLinkTimecode timecode;
+	{
+		std::unique_lock lock(TimecodeMutex);
+		timecode = Timecode;
+		if (TimecodeMode == NOS_DECKLINK_OUTPUT_TIMECODE_MODE_GENERATE)
+		{
+			uint32_t frameRate = uint32_t((TimeScale + FrameDuration / 2) / FrameDuration);
+			// Above 30 fps, regular timecodes count frame pairs and mark the second frame of each pair.
+			bool framePairs = frameRate > 30 && TimecodeFormat != NOS_DECKLINK_TIMECODE_FORMAT_RP188_HIGH_FRAME_RATE;
+			uint32_t timecodeRate = framePairs ? frameRate / 2 : frameRate;
+			uint64_t start = TimecodeToFrameCount(Timecode, timecodeRate);
+			if (framePairs)
+				start = start * 2 + Timecode.FieldMark;
+			uint64_t frameCount = start + frameNumber - TimecodeStartFrame;
+			timecode = FrameCountToTimecode(framePairs ? frameCount / 2 : frameCount, timecodeRate, Timecode.DropFrame);
+			timecode.FieldMark = framePairs && frameCount % 2;
+			timecode.UserBits = Timecode.UserBits;
+		}
+	}
+	if (!WriteTimecode(frame, GetDeckLinkTimecodeFormat(TimecodeFormat), timecode))
+		nosEngine.LogE("(Device %d) %s DMA Write: Failed to set timecode", DeviceIndex, GetChannelName(Channel));
+}
+
+void OutputHandler::UpdateHDRMetadataOfFrame(size_t frameIndex)
+{
+	std::unique_lock lock(HDRMetadataMutex);
+	if (FrameHDRMetadataVersions[frameIndex] == HDRMetadataVersion)
+		return;
+	if (!WriteHDRMetadata(VideoFrames[frameIndex], HDRMetadata))
+		nosEngine.LogE("(Device %d) %s DMA Write: Failed to set HDR metadata", DeviceIndex, GetChannelName(Channel));
+	FrameHDRMetadataVersions[frameIndex] = HDRMetadataVersion;
+}
+
+bool OutputHandler::UsesHardwareKeyer() const
+{
+	return KeyerMode == NOS_DECKLINK_KEYER_MODE_INTERNAL || KeyerMode == NOS_DECKLINK_KEYER_MODE_EXTERNAL;
+}
+
+bool OutputHandler::SetKeyerLevel(uint8_t level)
+{
+	if (!UsesHardwareKeyer())
+	{
+		nosEngine.LogE("(Device %d) %s Output: Keyer level needs the hardware keyer", DeviceIndex, GetChannelName(Channel));
+		return false;
+	}
+	return Keyer->SetLevel(level) == S_OK;
+}
+
+bool OutputHandler::RampKeyer(bool up, uint32_t frameCount)
+{
+	if (!UsesHardwareKeyer())
+	{
+		nosEngine.LogE("(Device %d) %s Output: Keyer ramp needs the hardware keyer", DeviceIndex, GetChannelName(Channel));
+		return false;
+	}
+	return (up ? Keyer->RampUp(frameCount) : Keyer->RampDown(frameCount)) == S_OK;
+}
+
+void OutputHandler::SetHDRMetadata(nosDeckLinkHDRMetadata const& metadata)
+{
+	std::unique_lock lock(HDRMetadataMutex);
+	if (IsSameHDRMetadata(metadata, HDRMetadata))
+		return;
+	HDRMetadata = metadata;
+	++HDRMetadataVersion;
+}
+
+bool OutputHandler::SetTimecode(nosDeckLinkTimecode const& timecode)
+{
+	if (TimecodeMode == NOS_DECKLINK_OUTPUT_TIMECODE_MODE_NONE)
+	{
+		nosEngine.LogE("(Device %d) %s Output: Channel is not opened with a timecode mode", DeviceIndex, GetChannelName(Channel));
+		return false;
+	}
+	std::unique_lock lock(TimecodeMutex);
+	Timecode = timecode;
+	TimecodeStartFrame = TotalFramesScheduled;
+	return true;
+}
+
+uint32_t OutputHandler::GetAudioSampleFrameCountOfFrame(uint64_t frameNumber) const
+{
+	// Computed from the start of the stream, so fractional frame rates never accumulate rounding errors.
+	auto samplesUntil = [this](uint64_t frame) { return frame * FrameDuration * bmdAudioSampleRate48kHz / TimeScale; };
+	return uint32_t(samplesUntil(frameNumber + 1) - samplesUntil(frameNumber));
+}
+
+void OutputHandler::ScheduleAudioOfFrame(uint64_t frameNumber)
+{
+	uint32_t sampleFrameCount = GetAudioSampleFrameCountOfFrame(frameNumber);
+	size_t bytesPerSampleFrame = Audio.GetBytesPerSampleFrame();
+	size_t requiredSize = sampleFrameCount * bytesPerSampleFrame;
+	std::unique_lock lock(AudioMutex);
+	if (AudioBlock.size() < requiredSize)
+		return;
+	if (AudioBlockSize < requiredSize)
+	{
+		// Underrun: Pad with silence so the following frames' audio stays at the same stream time as their video.
+		std::memset(AudioBlock.data() + AudioBlockSize, 0, requiredSize - AudioBlockSize);
+		SilentAudioSampleFramesInserted += (requiredSize - AudioBlockSize) / bytesPerSampleFrame;
+	}
+	AudioBlockSize = 0;
+	uint32_t written = 0;
+	auto res = Interface->ScheduleAudioSamples(AudioBlock.data(), sampleFrameCount, frameNumber * FrameDuration, TimeScale, &written);
+	if (res != S_OK || written != sampleFrameCount)
+		nosEngine.LogE("(Device %d) %s Audio Write: Scheduled %u of %u sample frames", DeviceIndex, GetChannelName(Channel), written, sampleFrameCount);
+	uint32_t buffered = 0;
+	if (Interface->GetBufferedAudioSampleFrameCount(&buffered) == S_OK)
+	{
+		MinBufferedAudioSampleFrames = std::min(MinBufferedAudioSampleFrames, buffered);
+		MaxBufferedAudioSampleFrames = std::max(MaxBufferedAudioSampleFrames, buffered);
+	}
+}
+
+bool OutputHandler::WriteAudio(const void* buffer, size_t size)
+{
+	if (!Audio.IsEnabled())
+	{
+		nosEngine.LogE("(Device %d) %s Audio Write: Audio is not enabled", DeviceIndex, GetChannelName(Channel));
+		return false;
+	}
+	std::unique_lock lock(AudioMutex);
+	size_t copySize = std::min(size, AudioBlock.size() - AudioBlockSize);
+	if (copySize != size)
+		nosEngine.LogW("(Device %d) %s Audio Write: More samples than a frame holds, extra samples are dropped", DeviceIndex, GetChannelName(Channel));
+	std::memcpy(AudioBlock.data() + AudioBlockSize, buffer, copySize);
+	AudioBlockSize += copySize;
+	return true;
+}
+
+bool OutputHandler::GetAudioOutputStatus(nosDeckLinkAudioOutputStatus& outStatus)
+{
+	if (!Audio.IsEnabled())
+	{
+		nosEngine.LogE("(Device %d) %s Audio Status: Audio is not enabled", DeviceIndex, GetChannelName(Channel));
+		return false;
+	}
+	uint32_t buffered = 0;
+	Interface->GetBufferedAudioSampleFrameCount(&buffered);
+	std::unique_lock lock(AudioMutex);
+	outStatus = nosDeckLinkAudioOutputStatus{
+		.BufferedSampleFrameCount = buffered,
+		.MinBufferedSampleFrameCount = MinBufferedAudioSampleFrames == UINT32_MAX ? 0 : MinBufferedAudioSampleFrames,
+		.MaxBufferedSampleFrameCount = MaxBufferedAudioSampleFrames,
+		.SilentSampleFramesInserted = SilentAudioSampleFramesInserted,
+	};
+	return true;
 }
 
 void OutputHandler::ScheduledFrameCompleted_DeckLinkThread(IDeckLinkVideoFrame* completedFrame, BMDOutputFrameCompletionResult result)
@@ -261,9 +711,14 @@ void OutputHandler::ScheduledFrameCompleted_DeckLinkThread(IDeckLinkVideoFrame*
 	switch (result)
 	{
 	case bmdOutputFrameCompleted:
+		++FramesCompleted;
+		return;
 	case bmdOutputFrameFlushed:
 		return;
 	case bmdOutputFrameDisplayedLate:
+		++FramesCompleted;
+		++FramesDisplayedLate;
+		// Reported as a drop to callbacks so that the first late frame triggers recovery, it was still displayed.
 		if (FramePointFirstDisplayedLate == -1)
 		{
 			FramePointFirstDisplayedLate = TotalFramesScheduled;
@@ -271,6 +726,7 @@ void OutputHandler::ScheduledFrameCompleted_DeckLinkThread(IDeckLinkVideoFrame*
 		}
 		break;
 	case bmdOutputFrameDropped:
+		++FramesDropped;
 		frameResult = NOS_DECKLINK_FRAME_DROPPED;
 		break;
 	}
@@ -2,12 +2,16 @@
 #pragma once
 
 #include "Common.hpp"
+#include "FrameAllocator.hpp"
+#include "Timecode.hpp"
+#include "HDRMetadata.hpp"
 
 namespace nos::decklink
 {
 struct OutputHandler : IOHandlerBase<IDeckLinkOutput>
 {
 	std::array<IDeckLinkMutableVideoFrame*, 2> VideoFrames{};
+	FrameBufferPool* BufferPool = nullptr;
 	
 	std::atomic_uint32_t TotalFramesScheduled = 0;
 
@@ -15,24 +19,107 @@ struct OutputHandler : IOHandlerBase<IDeckLinkOutput>
 	std::condition_variable WriteCond;
 	std::deque<IDeckLinkVideoFrame*> WriteQueue;
 
+	// Audio of the next frame to schedule. Sized for the longest frame at open, so writing never allocates.
+	std::mutex AudioMutex;
+	std::vector<uint8_t> AudioBlock;
+	size_t AudioBlockSize = 0;
+	uint32_t MinBufferedAudioSampleFrames = UINT32_MAX;
+	uint32_t MaxBufferedAudioSampleFrames = 0;
+	uint64_t SilentAudioSampleFramesInserted = 0;
+
+	// Set before open
+	nosDeckLinkOutputTimecodeMode TimecodeMode = NOS_DECKLINK_OUTPUT_TIMECODE_MODE_NONE;
+	nosDeckLinkTimecodeFormat TimecodeFormat = NOS_DECKLINK_TIMECODE_FORMAT_RP188_LTC;
+	std::mutex TimecodeMutex;
+	nosDeckLinkTimecode Timecode{}; // Manual: Timecode of the next frame. Generate: Timecode of frame TimecodeStartFrame.
+	uint64_t TimecodeStartFrame = 0;
+
+	// Frames are only updated when their version is behind.
+	std::mutex HDRMetadataMutex;
+	nosDeckLinkHDRMetadata HDRMetadata{};
+	uint64_t HDRMetadataVersion = 0;
+	std::array<uint64_t, 2> FrameHDRMetadataVersions{}; // Indexed as VideoFrames
+
+	// Set before open
+	nosDeckLinkKeyerMode KeyerMode = NOS_DECKLINK_KEYER_MODE_NONE;
+	nosDeckLinkKeyerSourceFormat KeyerSourceFormat = NOS_DECKLINK_KEYER_SOURCE_FORMAT_BGRA;
+	IDeckLinkKeyer* Keyer = nullptr; // May be null
+	OutputHandler* KeyOutput = nullptr; // Key channel of a fill/key pair, scheduled along with this one
+
 	~OutputHandler() override;
 
 	bool WaitFrame(std::chrono::milliseconds timeout) override;
-	void DmaTransfer(void* buffer, size_t size) override;
+	bool DmaTransfer(void* buffer, size_t size) override;
+	std::pair<size_t, int32_t> GetFrameMemoryPlacement() override;
+	bool WriteAudio(const void* buffer, size_t size);
+	bool GetAudioOutputStatus(nosDeckLinkAudioOutputStatus& outStatus);
+	bool SetTimecode(nosDeckLinkTimecode const& timecode);
+	void SetHDRMetadata(nosDeckLinkHDRMetadata const& metadata);
+	bool SetKeyerLevel(uint8_t level);
+	bool RampKeyer(bool up, uint32_t frameCount);
+	/// Switches an open, stopped output to another display mode and pixel format without closing it.
+	/// Frames are kept if their layout is the same, and their buffers are kept if their size is the same.
+	/// On failure the previous format is restored if possible.
+	bool Reconfigure(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat);
+	/// Warm standby. Schedules every frame as black, with silence if audio is enabled, without starting playback.
+	/// Starting the stream then plays out from the preroll, so the first frame written is displayed VideoFrames.size() frames after start.
+	bool Preroll();
+	bool IsPrerolled() const { return Prerolled; }
+	/// Leaves warm standby without starting playback, the next start schedules from scratch.
+	void CancelPreroll();
+	std::pair<BMDDisplayMode, BMDPixelFormat> GetFormat() const { return {DisplayMode, PixelFormat}; }
+	struct ReferenceClockPosition
+	{
+		BMDTimeValue Frame;
+		BMDTimeValue TimeInFrame;
+		BMDTimeValue TicksPerFrame;
+		BMDTimeScale TimeScale;
+	};
+	/// Position of the reference clock of the card in frames of this output, shared by the outputs of the card.
+	std::optional<ReferenceClockPosition> GetReferenceClockPosition();
 	
 	void ScheduleNextFrame();
 	void ScheduledFrameCompleted_DeckLinkThread(IDeckLinkVideoFrame* completedFrame, BMDOutputFrameCompletionResult result);
 	void ScheduledPlaybackHasStopped_DeckLinkThread();
 protected:
+	struct FrameLayout
+	{
+		long Width = 0;
+		long Height = 0;
+		int RowBytes = 0;
+		BMDPixelFormat PixelFormat = bmdFormatUnspecified;
+		BMDTimeValue FrameDuration = 0;
+		BMDTimeScale TimeScale = 0;
+	};
+	std::optional<FrameLayout> GetFrameLayout(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat);
+	bool HasFramesOfLayout(FrameLayout const& layout) const;
+	// Called with VideoFramesMutex held.
+	bool CreateFrames(FrameLayout const& layout);
+	bool EnableOutput(BMDDisplayMode displayMode);
+	void DisableOutput();
+	void ResetScheduling();
+	/// For a stopped output, schedules from scratch on the next start.
+	void DropScheduledFrames();
+	bool ApplyFormat(BMDDisplayMode displayMode, FrameLayout const& layout);
+
 	bool Open(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat) override;
 	bool Start() override;
 	bool Stop() override;
 	bool Close() override;
+	uint32_t GetAudioSampleFrameCountOfFrame(uint64_t frameNumber) const;
+	void ScheduleAudioOfFrame(uint64_t frameNumber);
+	void SetTimecodeOfFrame(IDeckLinkMutableVideoFrame* frame, uint64_t frameNumber);
+	void UpdateHDRMetadataOfFrame(size_t frameIndex);
+	bool UsesHardwareKeyer() const;
 
 	int64_t FramePointFirstDisplayedLate = -1;
 
 	std::mutex PlaybackStoppedMutex;
 	std::condition_variable PlaybackStoppedCond;
 	bool Closed = true;
+
+	std::atomic_bool Prerolled = false;
+	BMDDisplayMode DisplayMode = bmdModeUnknown;
+	BMDPixelFormat PixelFormat = bmdFormatUnspecified;
 };
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#include "Scheduling.hpp"
+
+#if _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace nos::decklink
+{
+
+#if _WIN32
+
+bool SetThreadScheduling(std::thread& thread, SchedulingPolicy policy, int32_t priority, std::string& outError)
+{
+	// Windows has no FIFO/RR classes, both map to the highest priority level within the process' priority class.
+	int threadPriority = policy == SchedulingPolicy::Default ? THREAD_PRIORITY_NORMAL : THREAD_PRIORITY_TIME_CRITICAL;
+	if (!SetThreadPriority((HANDLE)thread.native_handle(), threadPriority))
+	{
+		outError = "SetThreadPriority failed with error " + std::to_string(GetLastError());
+		return false;
+	}
+	return true;
+}
+
+#else
+
+bool SetThreadScheduling(std::thread& thread, SchedulingPolicy policy, int32_t priority, std::string& outError)
+{
+	int nativePolicy = SCHED_OTHER;
+	switch (policy)
+	{
+	case SchedulingPolicy::Fifo: nativePolicy = SCHED_FIFO; break;
+	case SchedulingPolicy::RoundRobin: nativePolicy = SCHED_RR; break;
+	default: priority = 0; break;
+	}
+	int minPriority = sched_get_priority_min(nativePolicy);
+	int maxPriority = sched_get_priority_max(nativePolicy);
+	if (priority < minPriority || priority > maxPriority)
+	{
+		outError = "priority " + std::to_string(priority) + " is out of range [" + std::to_string(minPriority) + ", " + std::to_string(maxPriority) + "]";
+		return false;
+	}
+	sched_param param{};
+	param.sched_priority = priority;
+	int res = pthread_setschedparam(thread.native_handle(), nativePolicy, &param);
+	if (res == EPERM)
+	{
+		outError = "not permitted, needs CAP_SYS_NICE or an RLIMIT_RTPRIO (ulimit -r) of at least " + std::to_string(priority);
+		return false;
+	}
+	if (res != 0)
+	{
+		outError = std::strerror(res);
+		return false;
+	}
+	return true;
+}
+
+#endif
+
+}
@@ -0,0 +1,21 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace nos::decklink
+{
+
+enum class SchedulingPolicy : uint8_t
+{
+	Default,
+	Fifo,
+	RoundRobin,
+};
+
+/// Changes the scheduling class of a thread. On failure, outError tells why.
+bool SetThreadScheduling(std::thread& thread, SchedulingPolicy policy, int32_t priority, std::string& outError);
+
+}
@@ -4,6 +4,9 @@
 #include <Nodos/Modules.h>
 #include <EnumConversions.hpp>
 
+#include "DeviceManager.hpp"
+#include "Numa.hpp"
+
 namespace nos::decklink
 {
 
@@ -22,6 +25,12 @@ SubDevice::SubDevice(IDeckLink* deviceInterface)
 	res = DLDevice->QueryInterface(IID_IDeckLinkOutput, (void**)&Output.Interface);
 	if (res != S_OK)
 		nosEngine.LogE("DeckLinkDevice: Failed to get output interface for device: %s", ModelName.c_str());
+	// Only used to report the detected input colorspace, not every device has it.
+	if (DLDevice->QueryInterface(IID_IDeckLinkStatus, (void**)&Input.Status) != S_OK)
+		Input.Status = nullptr;
+	// Only sub-devices that can key have it.
+	if (DLDevice->QueryInterface(IID_IDeckLinkKeyer, (void**)&Output.Keyer) != S_OK)
+		Output.Keyer = nullptr;
 
 	res = DLDevice->QueryInterface(IID_IDeckLinkProfileAttributes, (void**)&ProfileAttributes);
 	if (res != S_OK || !ProfileAttributes)
@@ -50,6 +59,8 @@ SubDevice::SubDevice(IDeckLink* deviceInterface)
 	{
 		Handle = DlToStdString(handle);
 		DeleteString(handle);
+		PciAddress = GetPciAddressOfDeviceHandle(Handle).value_or("");
+		NumaNode = GetNumaNodeOfDeviceHandle(Handle);
 	}
 	res = ProfileAttributes->GetInt(BMDDeckLinkProfileID, &ProfileId);
 	if (res != S_OK)
@@ -67,6 +78,10 @@ SubDevice::SubDevice(IDeckLink* deviceInterface)
 	if (res != S_OK)
 		nosEngine.LogE("DeckLinkDevice: Failed to get topological ID for device: %s", ModelName.c_str());
 
+	res = ProfileAttributes->GetInt(BMDDeckLinkMaximumAudioChannels, &MaxAudioChannels);
+	if (res != S_OK)
+		nosEngine.LogE("DeckLinkDevice: Failed to get maximum audio channel count for device: %s", ModelName.c_str());
+
 	res = DLDevice->QueryInterface(IID_IDeckLinkProfileManager, (void**)&ProfileManager);
 	if (res != S_OK || !ProfileManager)
 	{
@@ -77,6 +92,7 @@ SubDevice::SubDevice(IDeckLink* deviceInterface)
 
 SubDevice::~SubDevice()
 {
+	StopCapabilityProbe();
 	Release(ProfileAttributes);
 	Release(ProfileManager);
 }
@@ -98,25 +114,29 @@ bool SubDevice::IsBusy()
 	return Input.IsCurrentlyOpen() || Output.IsCurrentlyOpen();
 }
 
-std::map<nosMediaIOFrameGeometry, std::set<nosMediaIOFrameRate>> SubDevice::GetSupportedOutputFrameGeometryAndFrameRates(std::unordered_set<nosMediaIOPixelFormat> const& pixelFormats)
+bool SubDevice::IsFullDuplex() const
 {
-	std::map<nosMediaIOFrameGeometry, std::set<nosMediaIOFrameRate>> supported;
-	if (!Output)
-	{
-		nosEngine.LogE("SubDevice: Output interface is not available for device: %s", ModelName.c_str());
-		return supported;
-	}
+	return ProfileId == bmdProfileOneSubDeviceFullDuplex || ProfileId == bmdProfileTwoSubDevicesFullDuplex;
+}
 
-	for (auto& pixelFormat : pixelFormats)
+bool SubDevice::IsBusyFor(nosMediaIODirection mode)
+{
+	return IsFullDuplex() ? IsBusyWith(mode) : IsBusy();
+}
+
+std::map<nosMediaIOFrameGeometry, std::set<nosMediaIOFrameRate>> SubDevice::GetSupportedOutputFrameGeometryAndFrameRates(std::unordered_set<nosMediaIOPixelFormat> const& pixelFormats, BMDSupportedVideoModeFlags flags)
+{
+	std::map<nosMediaIOFrameGeometry, std::set<nosMediaIOFrameRate>> supported;
+	for (auto& [fg, frameRates] : GetSupportedOutputVideoFormats(flags))
 	{
-		for (int i = NOS_MEDIAIO_FRAME_GEOMETRY_MIN; i < NOS_MEDIAIO_FRAME_GEOMETRY_MAX; ++i)
+		for (auto& [frameRate, supportedPixelFormats] : frameRates)
 		{
-			auto fg = static_cast<nosMediaIOFrameGeometry>(i);
-			for (auto& displayMode : GetDisplayModesForFrameGeometry(fg))
+			for (auto& pixelFormat : supportedPixelFormats)
 			{
-				if (DoesSupportOutputVideoMode(displayMode, GetDeckLinkPixelFormat(pixelFormat)))
+				if (pixelFormats.contains(pixelFormat))
 				{
-					supported[fg].insert(GetFrameRateFromDisplayMode(displayMode));
+					supported[fg].insert(frameRate);
+					break;
 				}
 			}
 		}
@@ -124,9 +144,86 @@ std::map<nosMediaIOFrameGeometry, std::set<nosMediaIOFrameRate>> SubDevice::GetS
 	return supported;
 }
 
-std::map<nosMediaIOFrameGeometry, std::map<nosMediaIOFrameRate, std::set<nosMediaIOPixelFormat>>> SubDevice::GetSupportedOutputVideoFormats()
+std::optional<OutputVideoFormats> SubDevice::FindCachedOutputVideoFormats(BMDSupportedVideoModeFlags flags)
+{
+	std::unique_lock lock(CapabilityMutex);
+	auto it = OutputVideoFormatCache.find(flags);
+	if (it == OutputVideoFormatCache.end())
+		return std::nullopt;
+	return it->second;
+}
+
+OutputVideoFormats SubDevice::GetSupportedOutputVideoFormats(BMDSupportedVideoModeFlags flags)
+{
+	// The background probe fills the cache one flag set at a time, only wait for it if these flags are not probed yet.
+	if (auto cached = FindCachedOutputVideoFormats(flags))
+		return std::move(*cached);
+	if (CapabilitiesReady.valid())
+	{
+		CapabilitiesReady.wait();
+		if (auto cached = FindCachedOutputVideoFormats(flags))
+			return std::move(*cached);
+	}
+	auto supported = ProbeOutputVideoFormats(flags);
+	if (!supported)
+		return {};
+	std::unique_lock lock(CapabilityMutex);
+	OutputVideoFormatCache[flags] = *supported;
+	return std::move(*supported);
+}
+
+void SubDevice::RefreshCapabilities(std::atomic_bool const& stop)
+{
+	std::vector<BMDSupportedVideoModeFlags> flagsToProbe = {bmdSupportedVideoModeDefault};
+	BOOL supported = false;
+	if (ProfileAttributes && ProfileAttributes->GetFlag(BMDDeckLinkSupportsDualLinkSDI, &supported) == S_OK && supported)
+		flagsToProbe.push_back(bmdSupportedVideoModeSDIDualLink);
+	if (ProfileAttributes && ProfileAttributes->GetFlag(BMDDeckLinkSupportsQuadLinkSDI, &supported) == S_OK && supported)
+		flagsToProbe.push_back(bmdSupportedVideoModeSDIQuadLink);
+	for (auto flags : flagsToProbe)
+	{
+		auto formats = ProbeOutputVideoFormats(flags, &stop);
+		if (!formats)
+			return;
+		std::unique_lock lock(CapabilityMutex);
+		OutputVideoFormatCache[flags] = std::move(*formats);
+	}
+	OutputVideoFormatsByFlags probed;
+	{
+		std::unique_lock lock(CapabilityMutex);
+		probed = OutputVideoFormatCache;
+	}
+	DeviceManager::Instance()->CapabilityCache.Store(ModelName, PersistentId, ProfileId, probed);
+}
+
+void SubDevice::StartCapabilityProbe()
+{
+	StopCapabilityProbe();
+	if (auto cached = DeviceManager::Instance()->CapabilityCache.Find(ModelName, PersistentId, ProfileId))
+	{
+		std::unique_lock lock(CapabilityMutex);
+		OutputVideoFormatCache = std::move(*cached);
+		return;
+	}
+	CapabilitiesReady = std::async(std::launch::async, [this] {
+		ComThreadScope com;
+		RefreshCapabilities(CapabilityProbeStopRequested);
+	}).share();
+}
+
+void SubDevice::StopCapabilityProbe()
 {
-	std::map<nosMediaIOFrameGeometry, std::map<nosMediaIOFrameRate, std::set<nosMediaIOPixelFormat>>> supported;
+	if (!CapabilitiesReady.valid())
+		return;
+	CapabilityProbeStopRequested = true;
+	CapabilitiesReady.wait();
+	CapabilitiesReady = {};
+	CapabilityProbeStopRequested = false;
+}
+
+std::optional<OutputVideoFormats> SubDevice::ProbeOutputVideoFormats(BMDSupportedVideoModeFlags flags, std::atomic_bool const* stop)
+{
+	OutputVideoFormats supported;
 	if (!Output)
 	{
 		nosEngine.LogE("SubDevice: Output interface is not available for device: %s", ModelName.c_str());
@@ -143,7 +240,9 @@ std::map<nosMediaIOFrameGeometry, std::map<nosMediaIOFrameRate, std::set<nosMedi
 			auto fg = static_cast<nosMediaIOFrameGeometry>(i);
 			for (auto& displayMode : GetDisplayModesForFrameGeometry(fg))
 			{
-				if (DoesSupportOutputVideoMode(displayMode, GetDeckLinkPixelFormat(pixelFormat)))
+				if (stop && stop->load(std::memory_order_relaxed))
+					return std::nullopt;
+				if (DoesSupportOutputVideoMode(displayMode, GetDeckLinkPixelFormat(pixelFormat), flags))
 				{
 					supported[fg][GetFrameRateFromDisplayMode(displayMode)].insert(pixelFormat);
 				}
@@ -158,9 +257,9 @@ int32_t SubDevice::AddInputVideoFormatChangeCallback(nosDeckLinkInputVideoFormat
 	return Input.AddInputVideoFormatChangeCallback(callback, userData);
 }
 
-void SubDevice::RemoveInputVideoFormatChangeCallback(uint32_t callbackId)
+int32_t SubDevice::AddInputVideoFormatChangeCallbackV2(nosDeckLinkInputVideoFormatChangeCallbackV2 callback, void* userData)
 {
-	Input.RemoveInputVideoFormatChangeCallback(callbackId);
+	return Input.AddInputVideoFormatChangeCallbackV2(callback, userData);
 }
 
 int32_t SubDevice::AddFrameResultCallback(nosMediaIODirection dir, nosDeckLinkFrameResultCallback callback, void* userData)
@@ -168,9 +267,9 @@ int32_t SubDevice::AddFrameResultCallback(nosMediaIODirection dir, nosDeckLinkFr
 	return GetIO(dir).AddFrameResultCallback(callback, userData);
 }
 
-void SubDevice::RemoveFrameResultCallback(nosMediaIODirection dir, uint32_t callbackId)
+std::shared_ptr<ChannelCallbacks> SubDevice::GetCallbacks(nosMediaIODirection dir)
 {
-	GetIO(dir).RemoveFrameResultCallback(callbackId);
+	return GetIO(dir).GetCallbacks();
 }
 
 bool SubDevice::StartStream(nosMediaIODirection mode)
@@ -188,19 +287,26 @@ void SubDevice::TagChannel(nosMediaIODirection dir, nosDeckLinkChannel channel)
 	GetIO(dir).Channel = channel;
 }
 
-void SubDevice::TagDevice(uint32_t deviceIndex)
+nosDeckLinkChannel SubDevice::GetTaggedChannel(nosMediaIODirection dir)
+{
+	return GetIO(dir).Channel;
+}
+
+void SubDevice::TagDevice(uint32_t deviceIndex, std::shared_ptr<MemoryCounter> deviceMemory)
 {
 	GetIO(NOS_MEDIAIO_DIRECTION_INPUT).DeviceIndex = deviceIndex;
 	GetIO(NOS_MEDIAIO_DIRECTION_OUTPUT).DeviceIndex = deviceIndex;
+	GetIO(NOS_MEDIAIO_DIRECTION_INPUT).Memory->Total.Parent = deviceMemory;
+	GetIO(NOS_MEDIAIO_DIRECTION_OUTPUT).Memory->Total.Parent = deviceMemory;
 }
 
-bool SubDevice::DoesSupportOutputVideoMode(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat)
+bool SubDevice::DoesSupportOutputVideoMode(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat, BMDSupportedVideoModeFlags flags)
 {
 	if (!Output)
 		return false;
 	BOOL supported{};
 	BMDDisplayMode actualDisplayMode{};
-	auto res = Output->DoesSupportVideoMode(bmdVideoConnectionSDI, displayMode, pixelFormat, bmdNoVideoOutputConversion, bmdSupportedVideoModeDefault, &actualDisplayMode, &supported);
+	auto res = Output->DoesSupportVideoMode(bmdVideoConnectionSDI, displayMode, pixelFormat, bmdNoVideoOutputConversion, flags, &actualDisplayMode, &supported);
 	if (res != S_OK)
 	{
 		nosEngine.LogE("SubDevice: Failed to check video mode support for device: %s", ModelName.c_str());
@@ -215,16 +321,201 @@ bool SubDevice::DoesSupportOutputVideoMode(BMDDisplayMode displayMode, BMDPixelF
 	return supported;
 }
 
-bool SubDevice::OpenOutput(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat)
+bool SubDevice::SetOutputLinkConfiguration(nosDeckLinkChannel channel)
+{
+	auto linkConfiguration = GetDeckLinkLinkConfiguration(channel);
+	if (linkConfiguration != bmdLinkConfigurationSingleLink)
+	{
+		auto attribute = linkConfiguration == bmdLinkConfigurationDualLink ? BMDDeckLinkSupportsDualLinkSDI : BMDDeckLinkSupportsQuadLinkSDI;
+		BOOL supported = false;
+		if (!ProfileAttributes || ProfileAttributes->GetFlag(attribute, &supported) != S_OK || !supported)
+		{
+			nosEngine.LogE("SubDevice: %s SDI is not supported by device: %s", linkConfiguration == bmdLinkConfigurationDualLink ? "Dual link" : "Quad link", ModelName.c_str());
+			return false;
+		}
+	}
+	IDeckLinkConfiguration* configuration = nullptr;
+	if (DLDevice->QueryInterface(IID_IDeckLinkConfiguration, (void**)&configuration) != S_OK || !configuration)
+	{
+		// Single link is the only configuration of devices without a configuration interface.
+		if (linkConfiguration == bmdLinkConfigurationSingleLink)
+			return true;
+		nosEngine.LogE("SubDevice: Failed to get configuration interface for device: %s", ModelName.c_str());
+		return false;
+	}
+	bool ok = true;
+	if (configuration->SetInt(bmdDeckLinkConfigSDIOutputLinkConfiguration, linkConfiguration) != S_OK)
+	{
+		// Devices without multi-link outputs may reject the setting altogether.
+		if (linkConfiguration != bmdLinkConfigurationSingleLink)
+		{
+			nosEngine.LogE("SubDevice: Failed to set SDI output link configuration for device: %s", ModelName.c_str());
+			ok = false;
+		}
+	}
+	else if (linkConfiguration == bmdLinkConfigurationQuadLink && configuration->SetFlag(bmdDeckLinkConfigQuadLinkSDIVideoOutputSquareDivisionSplit, IsSquareDivisionChannel(channel)) != S_OK)
+	{
+		nosEngine.LogE("SubDevice: Failed to set quad-link split mode for device: %s", ModelName.c_str());
+		ok = false;
+	}
+	Release(configuration);
+	return ok;
+}
+
+FrameMemoryPolicy SubDevice::GetFrameMemoryPolicy() const
+{
+	auto& settings = DeviceManager::Instance()->Settings;
+	FrameMemoryPolicy policy{};
+	if (settings.numa->allocate_on_device_node)
+		policy.NumaNode = NumaNode;
+	policy.LockInMemory = settings.thread_scheduling->lock_frame_memory;
+	policy.SharedPool = settings.frame_memory->shared_pool;
+	switch (settings.frame_memory->huge_pages)
+	{
+	case sys::decklink::HugePageMode::Transparent: policy.HugePageMode = HugePages::Transparent; break;
+	case sys::decklink::HugePageMode::Explicit: policy.HugePageMode = HugePages::Explicit; break;
+	default: break;
+	}
+	return policy;
+}
+
+std::pair<size_t, int32_t> SubDevice::GetFrameMemoryPlacement(nosMediaIODirection dir)
+{
+	return GetIO(dir).GetFrameMemoryPlacement();
+}
+
+bool SubDevice::CanUseAudioFormat(AudioFormat const& audio) const
+{
+	if (audio.ChannelCount > MaxAudioChannels)
+	{
+		nosEngine.LogE("SubDevice: %u audio channels requested, device %s supports up to %lld", audio.ChannelCount, ModelName.c_str(), (long long)MaxAudioChannels);
+		return false;
+	}
+	return true;
+}
+
+bool SubDevice::OpenOutput(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat, AudioFormat audio, nosDeckLinkOutputTimecodeMode timecodeMode, nosDeckLinkTimecodeFormat timecodeFormat, nosDeckLinkKeyerMode keyerMode, nosDeckLinkKeyerSourceFormat keyerSourceFormat)
 {
 	if (!Output) 
 	{
 		nosEngine.LogE("SubDevice: Output interface is not available for device: %s", ModelName.c_str());
 		return false;
 	}
+	if (!CanUseAudioFormat(audio))
+		return false;
+	if (!CanUseKeyerMode(keyerMode))
+		return false;
+	Output.FrameMemory = GetFrameMemoryPolicy();
+	Output.Audio = audio;
+	Output.TimecodeMode = timecodeMode;
+	Output.TimecodeFormat = timecodeFormat;
+	Output.KeyerMode = keyerMode;
+	Output.KeyerSourceFormat = keyerSourceFormat;
+	if (keyerMode != NOS_DECKLINK_KEYER_MODE_NONE)
+		pixelFormat = bmdFormat8BitBGRA;
 	return Output.OpenStream(displayMode, pixelFormat);
 }
 
+bool SubDevice::ReconfigureOutput(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat)
+{
+	if (!Output.IsCurrentlyOpen())
+	{
+		nosEngine.LogE("SubDevice: Output is not open for device: %s", ModelName.c_str());
+		return false;
+	}
+	if (Output.KeyerMode != NOS_DECKLINK_KEYER_MODE_NONE)
+		pixelFormat = bmdFormat8BitBGRA;
+	return Output.Reconfigure(displayMode, pixelFormat);
+}
+
+std::pair<BMDDisplayMode, BMDPixelFormat> SubDevice::GetOutputFormat() const
+{
+	return Output.GetFormat();
+}
+
+bool SubDevice::PrerollOutput()
+{
+	if (!Output.IsCurrentlyOpen())
+	{
+		nosEngine.LogE("SubDevice: Output is not open for device: %s", ModelName.c_str());
+		return false;
+	}
+	return Output.Preroll();
+}
+
+bool SubDevice::IsOutputPrerolled() const
+{
+	return Output.IsPrerolled();
+}
+
+void SubDevice::CancelOutputPreroll()
+{
+	Output.CancelPreroll();
+}
+
+bool SubDevice::IsOutputRunning() const
+{
+	return Output.IsCurrentlyRunning();
+}
+
+std::optional<OutputHandler::ReferenceClockPosition> SubDevice::GetOutputReferenceClockPosition()
+{
+	return Output.GetReferenceClockPosition();
+}
+
+bool SubDevice::CanUseKeyerMode(nosDeckLinkKeyerMode keyerMode) const
+{
+	BMDDeckLinkAttributeID attribute;
+	switch (keyerMode)
+	{
+	case NOS_DECKLINK_KEYER_MODE_INTERNAL: attribute = BMDDeckLinkSupportsInternalKeying; break;
+	case NOS_DECKLINK_KEYER_MODE_EXTERNAL: attribute = BMDDeckLinkSupportsExternalKeying; break;
+	default: return true;
+	}
+	BOOL supported = false;
+	if (!Output.Keyer || !ProfileAttributes || ProfileAttributes->GetFlag(attribute, &supported) != S_OK || !supported)
+	{
+		nosEngine.LogE("SubDevice: %s keying is not supported by device: %s", keyerMode == NOS_DECKLINK_KEYER_MODE_INTERNAL ? "Internal" : "External", ModelName.c_str());
+		return false;
+	}
+	return true;
+}
+
+void SubDevice::SetKeyOutput(SubDevice* keySubDevice)
+{
+	Output.KeyOutput = keySubDevice ? &keySubDevice->Output : nullptr;
+}
+
+bool SubDevice::SetOutputKeyerLevel(uint8_t level)
+{
+	return Output.SetKeyerLevel(level);
+}
+
+bool SubDevice::RampOutputKeyer(bool up, uint32_t frameCount)
+{
+	return Output.RampKeyer(up, frameCount);
+}
+
+bool SubDevice::WriteAudio(const void* buffer, size_t size)
+{
+	return Output.WriteAudio(buffer, size);
+}
+
+bool SubDevice::GetAudioOutputStatus(nosDeckLinkAudioOutputStatus& outStatus)
+{
+	return Output.GetAudioOutputStatus(outStatus);
+}
+
+bool SubDevice::SetOutputTimecode(nosDeckLinkTimecode const& timecode)
+{
+	return Output.SetTimecode(timecode);
+}
+
+void SubDevice::SetOutputHDRMetadata(nosDeckLinkHDRMetadata const& metadata)
+{
+	Output.SetHDRMetadata(metadata);
+}
+
 bool SubDevice::CloseOutput()
 {
 	if (!Output)
@@ -235,16 +526,37 @@ bool SubDevice::CloseOutput()
 	return Output.CloseStream();
 }
 
-bool SubDevice::OpenInput(BMDPixelFormat pixelFormat)
+bool SubDevice::OpenInput(BMDPixelFormat pixelFormat, AudioFormat audio, bool captureAncillaryPackets, bool dualStream3D)
 {
 	if (!Input)
 	{
 		nosEngine.LogE("SubDevice: Input interface is not available for device: %s", ModelName.c_str());
 		return false;
 	}
+	if (!CanUseAudioFormat(audio))
+		return false;
+	Input.FrameMemory = GetFrameMemoryPolicy();
+	Input.Audio = audio;
+	Input.CaptureAncillaryPackets = captureAncillaryPackets;
+	Input.DualStream3D = dualStream3D;
 	return Input.OpenStream(bmdModeNTSC, pixelFormat); // Display mode will be auto-detected
 }
 
+bool SubDevice::ReadAudio(void* buffer, size_t size, nosDeckLinkAudioPacketInfo& outInfo)
+{
+	return Input.ReadAudio(buffer, size, outInfo);
+}
+
+bool SubDevice::ReadAncillaryPackets(nosDeckLinkAncillaryPacketList& outList)
+{
+	return Input.ReadAncillaryPackets(outList);
+}
+
+std::optional<nosDeckLinkFrameInfo> SubDevice::GetLastReadFrameInfo()
+{
+	return Input.GetLastReadFrameInfo();
+}
+
 bool SubDevice::CloseInput()
 {
 	if (!Input)
@@ -267,9 +579,9 @@ bool SubDevice::WaitFrame(nosMediaIODirection dir, std::chrono::milliseconds tim
 	return GetIO(dir).WaitFrame(timeout);
 }
 
-void SubDevice::DmaTransfer(nosMediaIODirection dir, void* buffer, size_t size)
+bool SubDevice::DmaTransfer(nosMediaIODirection dir, void* buffer, size_t size)
 {
-	GetIO(dir).DmaTransfer(buffer, size);
+	return GetIO(dir).DmaTransfer(buffer, size);
 }
 
 std::optional<nosVec2u> SubDevice::GetDeltaSeconds(nosMediaIODirection dir)
@@ -2,6 +2,9 @@
 #pragma once
 
 #include "Common.hpp"
+#include "CapabilityCache.hpp"
+
+#include <future>
 
 #include "OutputHandler.hpp"
 #include "InputHandler.hpp"
@@ -18,12 +21,22 @@ public:
 	~SubDevice();
 	bool IsBusyWith(nosMediaIODirection mode);
 	bool IsBusy();
-	std::map<nosMediaIOFrameGeometry, std::set<nosMediaIOFrameRate>> GetSupportedOutputFrameGeometryAndFrameRates(std::unordered_set<nosMediaIOPixelFormat> const& pixelFormats);
-	std::map<nosMediaIOFrameGeometry, std::map<nosMediaIOFrameRate, std::set<nosMediaIOPixelFormat>>> GetSupportedOutputVideoFormats();
+	bool IsFullDuplex() const;
+	/// Half-duplex sub-devices run one stream at a time, full-duplex ones can capture and play out at the same time.
+	bool IsBusyFor(nosMediaIODirection mode);
+	std::map<nosMediaIOFrameGeometry, std::set<nosMediaIOFrameRate>> GetSupportedOutputFrameGeometryAndFrameRates(std::unordered_set<nosMediaIOPixelFormat> const& pixelFormats, BMDSupportedVideoModeFlags flags = bmdSupportedVideoModeDefault);
+	OutputVideoFormats GetSupportedOutputVideoFormats(BMDSupportedVideoModeFlags flags = bmdSupportedVideoModeDefault);
+	/// Probes the output formats of every link configuration of the sub-device into the capability cache.
+	/// Returns early, leaving the cache as is, once stop is set.
+	void RefreshCapabilities(std::atomic_bool const& stop);
+	/// Loads capabilities from the on-disk cache, otherwise runs RefreshCapabilities in the background.
+	/// Queries of supported formats wait for it instead of probing again.
+	void StartCapabilityProbe();
+	void StopCapabilityProbe();
 	int32_t AddInputVideoFormatChangeCallback(nosDeckLinkInputVideoFormatChangeCallback callback, void* userData);
-	void RemoveInputVideoFormatChangeCallback(uint32_t callbackId);
+	int32_t AddInputVideoFormatChangeCallbackV2(nosDeckLinkInputVideoFormatChangeCallbackV2 callback, void* userData);
 	int32_t AddFrameResultCallback(nosMediaIODirection dir, nosDeckLinkFrameResultCallback callback, void* user_data);
-	void RemoveFrameResultCallback(nosMediaIODirection dir, uint32_t callbackId);
+	std::shared_ptr<ChannelCallbacks> GetCallbacks(nosMediaIODirection dir);
 
 	std::string ModelName;
 	int64_t SubDeviceIndex = -1;
@@ -32,17 +45,45 @@ public:
 	int64_t DeviceGroupId = -1;
 	int64_t TopologicalId = -1;
 	std::string Handle;
+	std::string PciAddress;
+	int32_t NumaNode = -1;
+	int64_t MaxAudioChannels = 0;
 
 	// Output
-	bool DoesSupportOutputVideoMode(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat);
-	bool OpenOutput(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat);
+	bool DoesSupportOutputVideoMode(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat, BMDSupportedVideoModeFlags flags = bmdSupportedVideoModeDefault);
+	/// Sets the number of SDI links and the quad-link split used by the output of the channel. Call before OpenOutput.
+	bool SetOutputLinkConfiguration(nosDeckLinkChannel channel);
+	bool OpenOutput(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat, AudioFormat audio, nosDeckLinkOutputTimecodeMode timecodeMode, nosDeckLinkTimecodeFormat timecodeFormat, nosDeckLinkKeyerMode keyerMode, nosDeckLinkKeyerSourceFormat keyerSourceFormat);
+	/// Output must be stopped. Keeps the audio, timecode and keyer settings of the open output.
+	bool ReconfigureOutput(BMDDisplayMode displayMode, BMDPixelFormat pixelFormat);
+	std::pair<BMDDisplayMode, BMDPixelFormat> GetOutputFormat() const;
+	bool PrerollOutput();
+	bool IsOutputPrerolled() const;
+	void CancelOutputPreroll();
+	bool IsOutputRunning() const;
+	std::optional<OutputHandler::ReferenceClockPosition> GetOutputReferenceClockPosition();
+	/// Key channel of a fill/key pair, null to detach.
+	void SetKeyOutput(SubDevice* keySubDevice);
+	bool SetOutputKeyerLevel(uint8_t level);
+	bool RampOutputKeyer(bool up, uint32_t frameCount);
+	bool SetOutputTimecode(nosDeckLinkTimecode const& timecode);
+	void SetOutputHDRMetadata(nosDeckLinkHDRMetadata const& metadata);
+	bool WriteAudio(const void* buffer, size_t size);
+	bool GetAudioOutputStatus(nosDeckLinkAudioOutputStatus& outStatus);
 	bool CloseOutput();
 	bool WaitFrame(nosMediaIODirection dir, std::chrono::milliseconds timeout);
-	void DmaTransfer(nosMediaIODirection dir, void* buffer, size_t size);
+	bool DmaTransfer(nosMediaIODirection dir, void* buffer, size_t size);
 	std::optional<nosVec2u> GetDeltaSeconds(nosMediaIODirection dir);
+	FrameMemoryPolicy GetFrameMemoryPolicy() const;
+	bool CanUseAudioFormat(AudioFormat const& audio) const;
+	bool CanUseKeyerMode(nosDeckLinkKeyerMode keyerMode) const;
+	std::pair<size_t, int32_t> GetFrameMemoryPlacement(nosMediaIODirection dir);
 
 	// Input
-	bool OpenInput(BMDPixelFormat pixelFormat);
+	bool OpenInput(BMDPixelFormat pixelFormat, AudioFormat audio, bool captureAncillaryPackets, bool dualStream3D);
+	bool ReadAudio(void* buffer, size_t size, nosDeckLinkAudioPacketInfo& outInfo);
+	bool ReadAncillaryPackets(nosDeckLinkAncillaryPacketList& outList);
+	std::optional<nosDeckLinkFrameInfo> GetLastReadFrameInfo();
 	bool CloseInput();
 
 	// Input/Output
@@ -50,15 +91,26 @@ public:
 	bool StopStream(nosMediaIODirection mode);
 
 	void TagChannel(nosMediaIODirection dir, nosDeckLinkChannel channel);
-	void TagDevice(uint32_t deviceIndex);
+	nosDeckLinkChannel GetTaggedChannel(nosMediaIODirection dir);
+	void TagDevice(uint32_t deviceIndex, std::shared_ptr<MemoryCounter> deviceMemory);
 
 	constexpr IOHandlerBaseI& GetIO(nosMediaIODirection dir);
 
 	IDeckLinkProfileManager* ProfileManager = nullptr;
 	IDeckLink* DLDevice = nullptr;
 protected:
+	std::optional<OutputVideoFormats> ProbeOutputVideoFormats(BMDSupportedVideoModeFlags flags, std::atomic_bool const* stop = nullptr);
+	std::optional<OutputVideoFormats> FindCachedOutputVideoFormats(BMDSupportedVideoModeFlags flags);
+
 	IDeckLinkProfileAttributes* ProfileAttributes = nullptr;
 
+	// Supported output formats by video mode flags. Probing takes hundreds of SDK calls, so results are kept until the sub-device is recreated.
+	std::mutex CapabilityMutex;
+	OutputVideoFormatsByFlags OutputVideoFormatCache;
+	// Ready once the background probe is done or stopped. Started and stopped under the exclusive device lock.
+	std::shared_future<void> CapabilitiesReady;
+	std::atomic_bool CapabilityProbeStopRequested = false;
+
 	OutputHandler Output;
 	InputHandler Input;
 };
@@ -0,0 +1,51 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#include "TaskQueue.hpp"
+
+#include "Common.hpp"
+
+namespace nos::decklink
+{
+
+TaskQueue::TaskQueue()
+{
+	Thread = std::thread([this] { Run(); });
+}
+
+TaskQueue::~TaskQueue()
+{
+	{
+		std::unique_lock lock(Mutex);
+		ShouldExit = true;
+	}
+	Cond.notify_one();
+	if (Thread.joinable())
+		Thread.join();
+}
+
+void TaskQueue::Push(std::function<void()> task)
+{
+	{
+		std::unique_lock lock(Mutex);
+		Tasks.push_back(std::move(task));
+	}
+	Cond.notify_one();
+}
+
+void TaskQueue::Run()
+{
+	ComThreadScope com;
+	std::unique_lock lock(Mutex);
+	while (true)
+	{
+		Cond.wait(lock, [this] { return ShouldExit || !Tasks.empty(); });
+		if (Tasks.empty())
+			return;
+		auto task = std::move(Tasks.front());
+		Tasks.pop_front();
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+}
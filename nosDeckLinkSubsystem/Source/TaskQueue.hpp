@@ -0,0 +1,33 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace nos::decklink
+{
+
+/// Runs tasks one at a time and in order on a thread of its own. Tasks may make SDK calls.
+class TaskQueue
+{
+public:
+	TaskQueue();
+	/// Runs the tasks that are still queued before returning.
+	~TaskQueue();
+
+	void Push(std::function<void()> task);
+
+protected:
+	void Run();
+
+	std::mutex Mutex;
+	std::condition_variable Cond;
+	std::deque<std::function<void()>> Tasks;
+	bool ShouldExit = false;
+	std::thread Thread;
+};
+
+}
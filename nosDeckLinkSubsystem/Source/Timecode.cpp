@@ -0,0 +1,87 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#include "Timecode.hpp"
+
+#include "EnumConversions.hpp"
+
+namespace nos::decklink
+{
+
+nosDeckLinkTimecode ReadTimecode(IDeckLinkVideoInputFrame* frame, BMDTimecodeFormat format)
+{
+	nosDeckLinkTimecode result{};
+	IDeckLinkTimecode* timecode = nullptr;
+	if (frame->GetTimecode(format, &timecode) != S_OK || !timecode)
+		return result;
+	if (timecode->GetComponents(&result.Hours, &result.Minutes, &result.Seconds, &result.Frames) == S_OK)
+	{
+		auto flags = timecode->GetFlags();
+		result.DropFrame = flags & bmdTimecodeIsDropFrame;
+		result.FieldMark = flags & bmdTimecodeFieldMark;
+		timecode->GetTimecodeUserBits(&result.UserBits);
+		result.Valid = true;
+	}
+	Release(timecode);
+	return result;
+}
+
+bool WriteTimecode(IDeckLinkMutableVideoFrame* frame, BMDTimecodeFormat format, nosDeckLinkTimecode const& timecode)
+{
+	BMDTimecodeFlags flags = bmdTimecodeFlagDefault;
+	if (timecode.DropFrame)
+		flags |= bmdTimecodeIsDropFrame;
+	if (timecode.FieldMark)
+		flags |= bmdTimecodeFieldMark;
+	if (frame->SetTimecodeFromComponents(format, timecode.Hours, timecode.Minutes, timecode.Seconds, timecode.Frames, flags) != S_OK)
+		return false;
+	return frame->SetTimecodeUserBits(format, timecode.UserBits) == S_OK;
+}
+
+static uint32_t GetDroppedFramesPerMinute(uint32_t timecodeRate, bool dropFrame)
+{
+	if (!dropFrame || timecodeRate % 30 != 0)
+		return 0;
+	return 2 * (timecodeRate / 30);
+}
+
+uint64_t TimecodeToFrameCount(nosDeckLinkTimecode const& timecode, uint32_t timecodeRate)
+{
+	uint64_t dropped = GetDroppedFramesPerMinute(timecodeRate, timecode.DropFrame);
+	uint64_t totalMinutes = 60ull * timecode.Hours + timecode.Minutes;
+	return (totalMinutes * 60 + timecode.Seconds) * timecodeRate + timecode.Frames - dropped * (totalMinutes - totalMinutes / 10);
+}
+
+nosDeckLinkTimecode FrameCountToTimecode(uint64_t frameCount, uint32_t timecodeRate, bool dropFrame)
+{
+	uint64_t dropped = GetDroppedFramesPerMinute(timecodeRate, dropFrame);
+	uint64_t framesPerDay = 24ull * 60 * 60 * timecodeRate - dropped * 24 * 60 * 9 / 10;
+	frameCount %= framesPerDay;
+	if (dropped)
+	{
+		// Add back the frame numbers skipped so far, then count as if nothing was dropped.
+		uint64_t framesPer10Minutes = 600ull * timecodeRate - dropped * 9;
+		uint64_t framesPerMinute = 60ull * timecodeRate - dropped;
+		uint64_t tens = frameCount / framesPer10Minutes;
+		uint64_t rest = frameCount % framesPer10Minutes;
+		frameCount += dropped * 9 * tens;
+		if (rest > dropped)
+			frameCount += dropped * ((rest - dropped) / framesPerMinute);
+	}
+	nosDeckLinkTimecode timecode{.Valid = true, .DropFrame = dropped != 0};
+	timecode.Frames = uint8_t(frameCount % timecodeRate);
+	frameCount /= timecodeRate;
+	timecode.Seconds = uint8_t(frameCount % 60);
+	frameCount /= 60;
+	timecode.Minutes = uint8_t(frameCount % 60);
+	timecode.Hours = uint8_t(frameCount / 60);
+	return timecode;
+}
+
+FrameTimecodes ReadTimecodes(IDeckLinkVideoInputFrame* frame)
+{
+	FrameTimecodes timecodes{};
+	for (int format = 0; format < NOS_DECKLINK_TIMECODE_FORMAT_COUNT; ++format)
+		timecodes[format] = ReadTimecode(frame, GetDeckLinkTimecodeFormat(nosDeckLinkTimecodeFormat(format)));
+	return timecodes;
+}
+
+}
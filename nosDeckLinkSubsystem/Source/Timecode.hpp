@@ -0,0 +1,24 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+#pragma once
+
+#include <array>
+
+#include "Common.hpp"
+
+namespace nos::decklink
+{
+
+using FrameTimecodes = std::array<nosDeckLinkTimecode, NOS_DECKLINK_TIMECODE_FORMAT_COUNT>;
+
+/// Timecode of the given format, Valid is false if the frame doesn't carry it.
+nosDeckLinkTimecode ReadTimecode(IDeckLinkVideoInputFrame* frame, BMDTimecodeFormat format);
+/// Every timecode format the SDK can capture, indexed by nosDeckLinkTimecodeFormat.
+FrameTimecodes ReadTimecodes(IDeckLinkVideoInputFrame* frame);
+bool WriteTimecode(IDeckLinkMutableVideoFrame* frame, BMDTimecodeFormat format, nosDeckLinkTimecode const& timecode);
+
+/// Frames since 00:00:00:00 at the given nominal timecode rate (e.g. 30 for 29.97). Drop frame counting
+/// skips frame numbers 0 and 1 (0 to 3 at 60) every minute except every tenth minute.
+uint64_t TimecodeToFrameCount(nosDeckLinkTimecode const& timecode, uint32_t timecodeRate);
+nosDeckLinkTimecode FrameCountToTimecode(uint64_t frameCount, uint32_t timecodeRate, bool dropFrame);
+
+}
@@ -1,6 +1,8 @@
 // Copyright MediaZ Teknoloji A.S. All Rights Reserved.
 #include "VideoFrame.hpp"
 
+#include <cstring>
+
 namespace nos::decklink
 {
 VideoFrame::VideoFrame(IDeckLinkVideoFrame* videoFrame)
@@ -42,4 +44,34 @@ bool VideoFrame::EndAccess()
 	return Buffer->EndAccess(*AccessFlags) == S_OK;
 }
 
-}
\ No newline at end of file
+bool FillBlack(IDeckLinkVideoFrame* videoFrame)
+{
+	VideoFrame frame(videoFrame);
+	frame.StartAccess(bmdBufferAccessWrite);
+	auto* bytes = static_cast<uint8_t*>(frame.GetBytes());
+	if (!bytes)
+		return false;
+	switch (videoFrame->GetPixelFormat())
+	{
+	case bmdFormat8BitYUV: {
+		// UYVY
+		constexpr uint8_t black[4] = {128, 16, 128, 16};
+		for (size_t i = 0; i + 4 <= frame.Size; i += 4)
+			std::memcpy(bytes + i, black, 4);
+		break;
+	}
+	case bmdFormat10BitYUV: {
+		// v210 packs 6 pixels into 4 words, Cb Y Cr and Y Cb Y alternate.
+		constexpr uint32_t black[2] = {512 | 64 << 10 | 512 << 20, 64 | 512 << 10 | 64 << 20};
+		for (size_t i = 0; i + 8 <= frame.Size; i += 8)
+			std::memcpy(bytes + i, black, 8);
+		break;
+	}
+	default:
+		std::memset(bytes, 0, frame.Size);
+		break;
+	}
+	return true;
+}
+
+}
@@ -20,4 +20,7 @@ protected:
 	IDeckLinkVideoBuffer* Buffer = nullptr;
 	std::optional<BMDBufferAccessFlags> AccessFlags = std::nullopt;
 };
+
+/// Fills the frame with black of its pixel format, YCbCr formats with legal black. Alpha, if any, is zero.
+bool FillBlack(IDeckLinkVideoFrame* videoFrame);
 }
\ No newline at end of file